@@ -36,8 +36,10 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
 
 #include <glib.h>
 #include <epan/conversation.h>
@@ -49,35 +51,45 @@
 
 #include <epan/req_resp_hdrs.h>
 #include "packet-spdy.h"
+#include "spdy-parse.h"
 #include <epan/dissectors/packet-tcp.h>
 #include <epan/dissectors/packet-ssl.h>
 #include <epan/prefs.h>
 #include <epan/expert.h>
 #include <epan/uat.h>
+#include <wsutil/file_util.h>
 
 #define MIN_SPDY_VERSION 3
+#define MAX_SPDY_VERSION 3
 
-/* The types of SPDY frames */
-#define SPDY_DATA           0
-#define SPDY_SYN_STREAM     1
-#define SPDY_SYN_REPLY      2
-#define SPDY_RST_STREAM     3
-#define SPDY_SETTINGS       4
-#define SPDY_PING           6
-#define SPDY_GOAWAY         7
-#define SPDY_HEADERS        8
-#define SPDY_WINDOW_UPDATE  9
-#define SPDY_CREDENTIAL    10
-#define SPDY_INVALID       11
-
-#define SPDY_FLAG_FIN  0x01
-#define SPDY_FLAG_UNIDIRECTIONAL 0x02
+/* Frame types and the common frame flags are in spdy-parse.h. */
 #define SPDY_FLAG_SETTINGS_CLEAR_SETTINGS 0x01
 
 /* Flags for each setting in a SETTINGS frame. */
 #define SPDY_FLAG_SETTINGS_PERSIST_VALUE 0x01
 #define SPDY_FLAG_SETTINGS_PERSISTED 0x02
 
+/* Header block inflaters kept around for reuse once their conversation's done. */
+#define SPDY_DECOMPRESSOR_POOL_SIZE 16
+
+/*
+ * Amount of a content-encoded body that is inflated at a time, and how much
+ * of the decoded output is kept when bodies aren't being reassembled.
+ */
+#define SPDY_BODY_INFLATE_CHUNK_SIZE 16384
+#define SPDY_BODY_DECODED_PREFIX_SIZE 4096
+
+/*
+ * Settings with a bearing on analysis.
+ */
+#define SPDY_SETTINGS_MAX_CONCURRENT_STREAMS 4
+
+/*
+ * Flow control.
+ */
+#define SPDY_SETTINGS_INITIAL_WINDOW_SIZE 7
+#define SPDY_DEFAULT_INITIAL_WINDOW 65536
+
 #define TCP_PORT_SPDY 6121
 #define SSL_PORT_SPDY 443
 
@@ -103,6 +115,16 @@ static const value_string frame_type_names[] = {
     { SPDY_WINDOW_UPDATE, "WINDOW_UPDATE" },
     { SPDY_CREDENTIAL,    "CREDENTIAL" },
     { SPDY_INVALID,       "INVALID" },
+    { 0,                  NULL }
+};
+
+/* What a truncated header block ran out before. */
+static const value_string header_status_names[] = {
+  { SPDY_HEADER_SHORT_NAME_LENGTH,  "name size" },
+  { SPDY_HEADER_SHORT_NAME,         "name" },
+  { SPDY_HEADER_SHORT_VALUE_LENGTH, "value size" },
+  { SPDY_HEADER_SHORT_VALUE,        "value" },
+  { 0, NULL }
 };
 
 static const value_string rst_stream_status_names[] = {
@@ -118,6 +140,7 @@ static const value_string rst_stream_status_names[] = {
   { 10, "INVALID_CREDENTIALS" },
   { 11, "FRAME_TOO_LARGE" },
   { 12, "INVALID" },
+  { 0,  NULL }
 };
 
 static const value_string setting_id_names[] = {
@@ -128,12 +151,28 @@ static const value_string setting_id_names[] = {
   { 5, "CURRENT_CWND" },
   { 6, "DOWNLOAD_RETRANS_RATE" },
   { 7, "INITIAL_WINDOW_SIZE" },
+  { 8, "CLIENT_CERTIFICATE_VECTOR_SIZE" },
+  { 0, NULL }
+};
+
+/* How a pushed stream ended. */
+#define SPDY_PUSH_PENDING    0
+#define SPDY_PUSH_COMPLETED  1
+#define SPDY_PUSH_REFUSED    2   /* reset by the client */
+#define SPDY_PUSH_RESET      3   /* reset by the server */
+
+static const value_string push_outcome_names[] = {
+  { SPDY_PUSH_COMPLETED, "Completed" },
+  { SPDY_PUSH_REFUSED,   "Reset by the client" },
+  { SPDY_PUSH_RESET,     "Reset by the server" },
+  { 0, NULL }
 };
 
 static const value_string goaway_status_names[] = {
   { 0,  "OK" },
   { 1,  "PROTOCOL_ERROR" },
   { 11, "INTERNAL_ERROR" },
+  { 0,  NULL }
 };
 
 /*
@@ -149,38 +188,267 @@ typedef struct _spdy_control_frame_info_t {
 } spdy_control_frame_info_t;
 
 /*
- * This structure will be tied to each SPDY header frame.
- * Only applies to frames containing headers: SYN_STREAM, SYN_REPLY, HEADERS
+ * Identifies a single SPDY frame: the packet it was seen in, the data
+ * source it was dissected from (the frame itself, a reassembled PDU or a
+ * decrypted SSL record), and its offset within that data source. The
+ * tvbs themselves are rebuilt on every pass, so they can't be the key.
+ */
+typedef struct _spdy_frame_key_t {
+    guint32 framenum;
+    guint32 source;   /* index in pinfo->data_src */
+    guint32 offset;   /* from the data source's beginning */
+} spdy_frame_key_t;
+
+/*
+ * This structure will be tied to each SPDY frame that needs state computed
+ * on the first pass to be dissected again later.
  * Note that there may be multiple SPDY frames in one packet.
  */
-typedef struct _spdy_header_info_t {
+typedef struct _spdy_frame_info_t {
+    spdy_frame_key_t key;
     guint32 stream_id;
-    guint8 *header_block;
-    guint   header_block_len;
     guint16 frame_type;
-} spdy_header_info_t;
+    /*
+     * Frames containing headers: SYN_STREAM, SYN_REPLY, HEADERS. The block
+     * may be in the header cache's mapping rather than se_ memory.
+     */
+    const guint8 *header_block;
+    guint   header_block_len;
+    /*
+     * Header-bearing frames: compressed and uncompressed header block bytes
+     * sent so far, up to and including this block, in its direction and on
+     * the connection as a whole.
+     */
+    guint64 dir_header_comp;
+    guint64 dir_header_uncomp;
+    guint64 conv_header_comp;
+    guint64 conv_header_uncomp;
+    /* DATA frames: entity body bytes decoded up to and including this one */
+    guint32 body_decoded_length;
+    /* DATA frames: entity bodies dropped to stay within the memory limit */
+    guint   bodies_evicted;
+    /*
+     * DATA frames: the entity body they are part of, so that it can be shown
+     * again; set on final frames, and on others whose body is being decoded
+     */
+    struct _spdy_entity_body_t *body;
+    /* Frames marking a milestone of their stream (SPDY_MILESTONE_*) */
+    guint8   milestones;
+    guint32  syn_stream_frame;
+    nstime_t time_since_syn_stream;
+    /* PING frames: the matching PING, and on the echo, the round trip time */
+    guint32  ping_match_frame;
+    gboolean ping_is_echo;
+    nstime_t ping_rtt;
+    /* DATA and WINDOW_UPDATE frames: the send windows they leave */
+    gboolean has_window;
+    gint32   window;
+    gboolean has_conn_window;
+    gint32   conn_window;
+    /*
+     * DATA frames from streams whose priority is known: lower-priority DATA
+     * payload bytes sent while this stream had data pending (see
+     * spdy_track_data_priority()), and the connection's totals so far.
+     */
+    gboolean has_priority;
+    guint8   priority;
+    guint32  bytes_ahead;
+    guint32  conv_priority_inversions;
+    guint64  conv_bytes_ahead;
+    /*
+     * Frames opening or closing a stream: the streams its opener then has
+     * open, and on SYN_STREAMs, the peer's MAX_CONCURRENT_STREAMS, if set.
+     */
+    gboolean has_concurrency;
+    guint32  concurrent_streams;
+    gboolean has_concurrency_limit;
+    guint32  concurrency_limit;
+    /* SETTINGS frames: each side's settings once the frame has been applied */
+    spdy_settings_t *settings;
+    /*
+     * Pushed streams: the SYN_STREAM of the stream they were pushed for,
+     * kept with the push's SYN_STREAM; and with the frame ending the push,
+     * how it ended, the bytes pushed, and the connection's totals so far.
+     */
+    guint32  push_parent_frame;
+    guint8   push_outcome;
+    guint32  push_rst_status;
+    guint64  pushed_bytes;
+    guint64  conv_push_useful;
+    guint64  conv_push_wasted;
+} spdy_frame_info_t;
 
 /*
- * This structures keeps track of all the data frames
- * associated with a stream, so that they can be
- * reassembled into a single chunk.
+ * A PING that hasn't been echoed back yet.
  */
-typedef struct _spdy_data_frame_t {
-    guint8 *data;
-    guint32 length;
-    guint32 framenum;
-} spdy_data_frame_t;
+typedef struct _spdy_ping_t {
+    spdy_frame_info_t *frame_info;
+    nstime_t           sent;
+    spdy_direction_t   direction;
+} spdy_ping_t;
 
-typedef struct _spdy_stream_info_t {
-    gchar *content_type;
-    gchar *content_type_parameters;
-    gchar *content_encoding;
-    GSList *data_frames;
+#define SPDY_MILESTONE_REPLY       0x01
+#define SPDY_MILESTONE_FIRST_BYTE  0x02
+#define SPDY_MILESTONE_CLOSED      0x04
+
+/*
+ * The entity body data kept for one side of a stream, from its first kept
+ * DATA frame until it is evicted or the capture is closed. These are
+ * g_malloc'ed and found by ID in spdy_bodies, so that nothing se_alloc'ed
+ * ever points at one.
+ */
+typedef struct _spdy_body_t {
+    guint32 id;
+    guint32 stream_id;
+    /* The body as it arrives, handed over to assembled_data once complete */
+    GByteArray *data;
     tvbuff_t *assembled_data;
+    /* Whether the body is being written out to a spool file instead */
+    gboolean spooled;
+    /* Link in spdy_retained_bodies; used to enforce spdy_max_body_memory */
+    GList *retained_link;
+    guint retained_bytes;
+} spdy_body_t;
+
+/*
+ * The frames carrying a given stream, gathered on the first pass. Streams
+ * are numbered across the whole capture in the order they're first seen.
+ */
+typedef struct _spdy_stream_frames_t {
+    guint32 index;
+    GArray *frames;   /* guint32 frame numbers, ascending, without repeats */
+} spdy_stream_frames_t;
+
+/*
+ * Kept for a segment (or decrypted SSL record) that starts with the rest
+ * of a DATA frame begun in an earlier one.
+ */
+typedef struct _spdy_data_continuation_t {
+    spdy_frame_key_t key;        /* of the segment's start */
+    spdy_partial_data_t frame;   /* as it stood before this segment */
+} spdy_data_continuation_t;
+
+/*
+ * What is known of a stream as a whole, as opposed to the entity body
+ * being received on it. This is carried over when the state for one body
+ * is retired and the stream goes on.
+ */
+typedef struct _spdy_stream_common_t {
+    const gchar *host;
+    gchar *path;
+    /* First-pass timing, from the SYN_STREAM on */
+    guint32  syn_stream_frame;
+    nstime_t syn_stream_time;
+    spdy_direction_t opener_direction;
+    gboolean unidirectional;
+    gboolean reply_seen;
+    gboolean first_byte_seen;
+    gboolean opener_fin;
+    gboolean peer_fin;
+    /* Send windows, indexed like spdy_conv_t's; set up by the SYN_STREAM */
+    gint64   send_window[2];
+    /* From the SYN_STREAM; 0 is the highest */
+    gboolean priority_known;
+    guint8   priority;
+    /*
+     * Per sending direction, indexed the same way: whether the stream still
+     * has data to send, and the lower-priority DATA bytes the connection had
+     * sent that way when it last sent some.
+     */
+    gboolean sending[2];
+    guint64  lower_priority_mark[2];
+    /* Whether the stream is counted in its opener's open streams */
+    gboolean counted_open;
+    /* Server push: the stream pushed for, DATA bytes pushed, outcome */
+    gboolean is_push;
+    guint32  associated_stream_id;
+    guint64  pushed_bytes;
+    guint8   push_outcome;
+} spdy_stream_common_t;
+
+/*
+ * What's known of the entity body one side of a stream sent, for showing
+ * its DATA frames again after the stream's own state is gone. It is
+ * se_alloc'ed on the first pass, when the body is finished or starts being
+ * decoded; the body data, while still kept, is found through body_id.
+ */
+typedef struct _spdy_entity_body_t {
+    guint32 stream_id;
+    /* 0 if no body data was kept */
+    guint32 body_id;
+    const gchar *host;
+    gchar *path;
+    const gchar *content_type;
+    const gchar *content_type_parameters;
+    const gchar *content_encoding;
+    guint8   skipped;
+    guint64  bytes_seen;
+    guint    num_data_frames;
+    /* The frames its kept DATA frames arrived in, each listed once */
+    guint32 *frames;
+    guint    num_frames;
+    gboolean body_decoded;
+    gboolean body_decode_failed;
+    guint32  encoded_length;
+    guint32  decoded_length;
+    gboolean body_evicted;
+    gboolean spool_failed;
+    const gchar *spool_path;
+    guint32  spooled_length;
+} spdy_entity_body_t;
+
+/*
+ * The entity body one side of a stream sends: what that side's headers
+ * said of it, whether it is kept at all under the body decoding
+ * preferences (SPDY_BODY_*), and what it takes to receive it as its DATA
+ * frames arrive. Bodies that aren't kept just have their DATA frames
+ * counted. All of it is reset once the body is finished.
+ */
+typedef struct _spdy_body_sender_t {
+    guint32 stream_id;
+    /* Interned; see spdy_intern() */
+    const gchar *content_type;
+    const gchar *content_type_parameters;
+    const gchar *content_encoding;
+    gboolean policy_checked;
+    guint8   skipped;
+    guint64  bytes_seen;
+    /* The body data kept so far, in spdy_bodies; 0 until there is some */
+    guint32 body_id;
+    /* The frames its kept DATA frames arrived in, each listed once */
+    GArray *frames;
     guint num_data_frames;
+    /*
+     * Content-encoded bodies are inflated as the DATA frames arrive; the
+     * body data then is the decoded body rather than the encoded one.
+     */
+    z_streamp body_decompressor;
+    gboolean body_decoded;
+    gboolean body_decode_failed;
+    guint32 encoded_length;
+    guint32 decoded_length;
+    gboolean body_evicted;
+    /*
+     * Bodies larger than spdy_spool_threshold are written out to a
+     * temporary file as they arrive instead of being kept in memory.
+     */
+    FILE *spool;
+    gchar *spool_path;
+    guint32 spooled_length;
+    gboolean spool_failed;
+    /* See spdy_get_entity_body() */
+    spdy_entity_body_t *entity;
+} spdy_body_sender_t;
+
+typedef struct _spdy_stream_info_t {
+    guint32 stream_id;
+    spdy_stream_common_t common;
+    /* Indexed by spdy_segment_side() */
+    spdy_body_sender_t sender[2];
 } spdy_stream_info_t;
 
 #include <epan/tap.h>
+#include <epan/stat_cmd_args.h>
 
 /* Handles for metadata population. */
 
@@ -200,9 +468,34 @@ static int hf_spdy_flags_persist_value = -1;
 static int hf_spdy_flags_persisted = -1;
 static int hf_spdy_length = -1;
 static int hf_spdy_header_block = -1;
+static int hf_spdy_header_block_comp_len = -1;
+static int hf_spdy_header_block_uncomp_len = -1;
+static int hf_spdy_header_block_ratio = -1;
+static int hf_spdy_dir_header_comp = -1;
+static int hf_spdy_dir_header_uncomp = -1;
+static int hf_spdy_conv_header_comp = -1;
+static int hf_spdy_conv_header_uncomp = -1;
 static int hf_spdy_header = -1;
 static int hf_spdy_header_name = -1;
 static int hf_spdy_header_value = -1;
+static int hf_spdy_method = -1;
+static int hf_spdy_path = -1;
+static int hf_spdy_http_version = -1;
+static int hf_spdy_host = -1;
+static int hf_spdy_scheme = -1;
+static int hf_spdy_status = -1;
+static int hf_spdy_content_type = -1;
+static int hf_spdy_content_encoding = -1;
+static int hf_spdy_content_length = -1;
+static int hf_spdy_user_agent = -1;
+static int hf_spdy_accept = -1;
+static int hf_spdy_accept_encoding = -1;
+static int hf_spdy_cookie = -1;
+static int hf_spdy_set_cookie = -1;
+static int hf_spdy_referer = -1;
+static int hf_spdy_location = -1;
+static int hf_spdy_server = -1;
+static int hf_spdy_cache_control = -1;
 static int hf_spdy_streamid = -1;
 static int hf_spdy_associated_streamid = -1;
 static int hf_spdy_priority = -1;
@@ -213,15 +506,36 @@ static int hf_spdy_setting = -1;
 static int hf_spdy_setting_id = -1;
 static int hf_spdy_setting_value = -1;
 static int hf_spdy_ping_id = -1;
+static int hf_spdy_ping_rtt = -1;
+static int hf_spdy_ping_response_in = -1;
+static int hf_spdy_ping_request_in = -1;
 static int hf_spdy_goaway_last_good_stream_id = -1;
 static int hf_spdy_goaway_status = -1;
 static int hf_spdy_window_update_delta = -1;
+static int hf_spdy_window = -1;
+static int hf_spdy_conn_window = -1;
+static int hf_spdy_stream_index = -1;
+static int hf_spdy_bytes_ahead = -1;
+static int hf_spdy_conv_priority_inversions = -1;
+static int hf_spdy_conv_bytes_ahead = -1;
+static int hf_spdy_concurrent_streams = -1;
+static int hf_spdy_concurrency_limit = -1;
+static int hf_spdy_push_parent_frame = -1;
+static int hf_spdy_push_outcome = -1;
+static int hf_spdy_pushed_bytes = -1;
+static int hf_spdy_conv_push_useful = -1;
+static int hf_spdy_conv_push_wasted = -1;
+static int hf_spdy_syn_stream_in = -1;
+static int hf_spdy_time_to_reply = -1;
+static int hf_spdy_time_to_first_byte = -1;
+static int hf_spdy_stream_duration = -1;
 
 static gint ett_spdy = -1;
 static gint ett_spdy_flags = -1;
 static gint ett_spdy_header_block = -1;
 static gint ett_spdy_header = -1;
 static gint ett_spdy_setting = -1;
+static gint ett_spdy_effective_settings = -1;
 
 static gint ett_spdy_encoded_entity = -1;
 
@@ -229,12 +543,167 @@ static dissector_handle_t data_handle;
 static dissector_handle_t media_handle;
 static dissector_handle_t spdy_handle;
 
+/* Subdissector tables for entity bodies, looked up once at handoff. */
+static dissector_table_t port_subdissector_table;
+static dissector_table_t media_type_subdissector_table;
+
+/* Why an entity body is not being kept. */
+#define SPDY_BODY_KEPT          0
+#define SPDY_BODY_SKIPPED_TYPE  1
+#define SPDY_BODY_SKIPPED_SIZE  2
+
+/*
+ * Media type subdissector handles, keyed by interned media type. Media
+ * types with no subdissector are kept too, with a NULL handle.
+ */
+static GHashTable *spdy_media_handles = NULL;
+
+/*
+ * Capture-scoped pool of the strings that many streams share: host names,
+ * media types, their parameters and content encodings. Each distinct value
+ * is stored once, so interned strings can be compared by pointer.
+ */
+static GHashTable *spdy_string_pool = NULL;
+
+/* A Content-Type header value, split into its media type and parameters. */
+typedef struct _spdy_content_type_t {
+  const gchar *media_type;
+  const gchar *parameters;
+  gboolean body_wanted;   /* under the body decoding preferences */
+} spdy_content_type_t;
+
+/* Parsed content types, keyed by the header value they were parsed from. */
+static GHashTable *spdy_content_types = NULL;
+
 /* Stuff for generation/handling of fields for custom HTTP headers */
 typedef struct _header_field_t {
         gchar* header_name;
         gchar* header_desc;
 } header_field_t;
 
+/* Custom header fields, configured with the custom_spdy_header_fields UAT. */
+static header_field_t *header_fields = NULL;
+static guint num_header_fields = 0;
+
+/*
+ * IDs of the custom header fields registered so far, keyed by header name.
+ * Fields can't be unregistered, so ones dropped from the table stay.
+ */
+static GHashTable *header_fields_hash = NULL;
+
+static void header_fields_update_cb(void *r, const char **err) {
+  header_field_t *rec = r;
+  gchar *c;
+  guchar bad;
+
+  if (rec->header_name == NULL) {
+    *err = ep_strdup_printf("Header name can't be empty");
+    return;
+  }
+  g_strstrip(rec->header_name);
+  if (rec->header_name[0] == '\0') {
+    *err = ep_strdup_printf("Header name can't be empty");
+    return;
+  }
+  /* SPDY header names are always lowercase. */
+  for (c = rec->header_name; *c != '\0'; c++) {
+    *c = g_ascii_tolower(*c);
+  }
+  /* Check for characters that would keep the field from registering. */
+  bad = proto_check_field_name(rec->header_name);
+  if (bad) {
+    *err = ep_strdup_printf("Header name can't contain '%c'", bad);
+    return;
+  }
+  if (strcmp(rec->header_name, "name") == 0 ||
+      strcmp(rec->header_name, "value") == 0) {
+    *err = ep_strdup_printf("spdy.header.%s is already a field",
+                            rec->header_name);
+    return;
+  }
+  *err = NULL;
+}
+
+static void *header_fields_copy_cb(void *n, const void *o,
+                                   size_t siz _U_) {
+  header_field_t *new_rec = n;
+  const header_field_t *old_rec = o;
+
+  new_rec->header_name = g_strdup(old_rec->header_name);
+  new_rec->header_desc = g_strdup(old_rec->header_desc);
+  return new_rec;
+}
+
+static void header_fields_free_cb(void *r) {
+  header_field_t *rec = r;
+
+  g_free(rec->header_name);
+  g_free(rec->header_desc);
+}
+
+UAT_CSTRING_CB_DEF(header_fields, header_name, header_field_t)
+UAT_CSTRING_CB_DEF(header_fields, header_desc, header_field_t)
+
+/*
+ * Registers a spdy.header.<name> field for each header in the table that
+ * doesn't have one yet.
+ */
+static void header_fields_post_update_cb(void) {
+  hf_register_info *hf;
+  guint num_new = 0;
+  guint i;
+
+  if (header_fields_hash == NULL) {
+    header_fields_hash = g_hash_table_new(g_str_hash, g_str_equal);
+  }
+  if (num_header_fields == 0) {
+    return;
+  }
+  hf = g_malloc0(sizeof(hf_register_info) * num_header_fields);
+  for (i = 0; i < num_header_fields; i++) {
+    gchar *header_name = header_fields[i].header_name;
+    gint *hf_id;
+
+    if (g_hash_table_lookup(header_fields_hash, header_name) != NULL) {
+      continue;
+    }
+    hf_id = g_malloc(sizeof(gint));
+    *hf_id = -1;
+    header_name = g_strdup(header_name);
+    hf[num_new].p_id = hf_id;
+    hf[num_new].hfinfo.name = header_name;
+    hf[num_new].hfinfo.abbrev = g_strdup_printf("spdy.header.%s",
+                                                header_name);
+    hf[num_new].hfinfo.type = FT_STRING;
+    hf[num_new].hfinfo.display = BASE_NONE;
+    hf[num_new].hfinfo.strings = NULL;
+    hf[num_new].hfinfo.blurb = g_strdup(header_fields[i].header_desc);
+    hf[num_new].hfinfo.same_name_prev = NULL;
+    hf[num_new].hfinfo.same_name_next = NULL;
+    g_hash_table_insert(header_fields_hash, header_name, hf_id);
+    num_new++;
+  }
+  if (num_new != 0) {
+    /* The registered fields keep pointing into this array. */
+    proto_register_field_array(proto_spdy, hf, num_new);
+  } else {
+    g_free(hf);
+  }
+}
+
+/*
+ * Returns the ID of the custom field for a header, or -1 if it has none.
+ */
+static int spdy_custom_header_field(const gchar *header_name) {
+  const gint *hf_id;
+
+  if (header_fields_hash == NULL) {
+    return -1;
+  }
+  hf_id = g_hash_table_lookup(header_fields_hash, header_name);
+  return hf_id != NULL ? *hf_id : -1;
+}
+
 static gboolean spdy_assemble_entity_bodies = TRUE;
 
 /*
@@ -247,422 +716,2048 @@ static gboolean spdy_decompress_headers = TRUE;
 static gboolean spdy_decompress_body = FALSE;
 static gboolean spdy_decompress_headers = FALSE;
 #endif
+
+/*
+ * Building with SPDY_DISABLE_DEBUG defined compiles the debug output, and
+ * its preference, out of the dissector altogether.
+ */
+#ifdef SPDY_DISABLE_DEBUG
+#define spdy_debug FALSE
+#else
 static gboolean spdy_debug = FALSE;
+#endif
 
-static const char spdy_dictionary[] = {
-  0x00, 0x00, 0x00, 0x07, 0x6f, 0x70, 0x74, 0x69,  // - - - - o p t i
-  0x6f, 0x6e, 0x73, 0x00, 0x00, 0x00, 0x04, 0x68,  // o n s - - - - h
-  0x65, 0x61, 0x64, 0x00, 0x00, 0x00, 0x04, 0x70,  // e a d - - - - p
-  0x6f, 0x73, 0x74, 0x00, 0x00, 0x00, 0x03, 0x70,  // o s t - - - - p
-  0x75, 0x74, 0x00, 0x00, 0x00, 0x06, 0x64, 0x65,  // u t - - - - d e
-  0x6c, 0x65, 0x74, 0x65, 0x00, 0x00, 0x00, 0x05,  // l e t e - - - -
-  0x74, 0x72, 0x61, 0x63, 0x65, 0x00, 0x00, 0x00,  // t r a c e - - -
-  0x06, 0x61, 0x63, 0x63, 0x65, 0x70, 0x74, 0x00,  // - a c c e p t -
-  0x00, 0x00, 0x0e, 0x61, 0x63, 0x63, 0x65, 0x70,  // - - - a c c e p
-  0x74, 0x2d, 0x63, 0x68, 0x61, 0x72, 0x73, 0x65,  // t - c h a r s e
-  0x74, 0x00, 0x00, 0x00, 0x0f, 0x61, 0x63, 0x63,  // t - - - - a c c
-  0x65, 0x70, 0x74, 0x2d, 0x65, 0x6e, 0x63, 0x6f,  // e p t - e n c o
-  0x64, 0x69, 0x6e, 0x67, 0x00, 0x00, 0x00, 0x0f,  // d i n g - - - -
-  0x61, 0x63, 0x63, 0x65, 0x70, 0x74, 0x2d, 0x6c,  // a c c e p t - l
-  0x61, 0x6e, 0x67, 0x75, 0x61, 0x67, 0x65, 0x00,  // a n g u a g e -
-  0x00, 0x00, 0x0d, 0x61, 0x63, 0x63, 0x65, 0x70,  // - - - a c c e p
-  0x74, 0x2d, 0x72, 0x61, 0x6e, 0x67, 0x65, 0x73,  // t - r a n g e s
-  0x00, 0x00, 0x00, 0x03, 0x61, 0x67, 0x65, 0x00,  // - - - - a g e -
-  0x00, 0x00, 0x05, 0x61, 0x6c, 0x6c, 0x6f, 0x77,  // - - - a l l o w
-  0x00, 0x00, 0x00, 0x0d, 0x61, 0x75, 0x74, 0x68,  // - - - - a u t h
-  0x6f, 0x72, 0x69, 0x7a, 0x61, 0x74, 0x69, 0x6f,  // o r i z a t i o
-  0x6e, 0x00, 0x00, 0x00, 0x0d, 0x63, 0x61, 0x63,  // n - - - - c a c
-  0x68, 0x65, 0x2d, 0x63, 0x6f, 0x6e, 0x74, 0x72,  // h e - c o n t r
-  0x6f, 0x6c, 0x00, 0x00, 0x00, 0x0a, 0x63, 0x6f,  // o l - - - - c o
-  0x6e, 0x6e, 0x65, 0x63, 0x74, 0x69, 0x6f, 0x6e,  // n n e c t i o n
-  0x00, 0x00, 0x00, 0x0c, 0x63, 0x6f, 0x6e, 0x74,  // - - - - c o n t
-  0x65, 0x6e, 0x74, 0x2d, 0x62, 0x61, 0x73, 0x65,  // e n t - b a s e
-  0x00, 0x00, 0x00, 0x10, 0x63, 0x6f, 0x6e, 0x74,  // - - - - c o n t
-  0x65, 0x6e, 0x74, 0x2d, 0x65, 0x6e, 0x63, 0x6f,  // e n t - e n c o
-  0x64, 0x69, 0x6e, 0x67, 0x00, 0x00, 0x00, 0x10,  // d i n g - - - -
-  0x63, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d,  // c o n t e n t -
-  0x6c, 0x61, 0x6e, 0x67, 0x75, 0x61, 0x67, 0x65,  // l a n g u a g e
-  0x00, 0x00, 0x00, 0x0e, 0x63, 0x6f, 0x6e, 0x74,  // - - - - c o n t
-  0x65, 0x6e, 0x74, 0x2d, 0x6c, 0x65, 0x6e, 0x67,  // e n t - l e n g
-  0x74, 0x68, 0x00, 0x00, 0x00, 0x10, 0x63, 0x6f,  // t h - - - - c o
-  0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x6c, 0x6f,  // n t e n t - l o
-  0x63, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x00, 0x00,  // c a t i o n - -
-  0x00, 0x0b, 0x63, 0x6f, 0x6e, 0x74, 0x65, 0x6e,  // - - c o n t e n
-  0x74, 0x2d, 0x6d, 0x64, 0x35, 0x00, 0x00, 0x00,  // t - m d 5 - - -
-  0x0d, 0x63, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74,  // - c o n t e n t
-  0x2d, 0x72, 0x61, 0x6e, 0x67, 0x65, 0x00, 0x00,  // - r a n g e - -
-  0x00, 0x0c, 0x63, 0x6f, 0x6e, 0x74, 0x65, 0x6e,  // - - c o n t e n
-  0x74, 0x2d, 0x74, 0x79, 0x70, 0x65, 0x00, 0x00,  // t - t y p e - -
-  0x00, 0x04, 0x64, 0x61, 0x74, 0x65, 0x00, 0x00,  // - - d a t e - -
-  0x00, 0x04, 0x65, 0x74, 0x61, 0x67, 0x00, 0x00,  // - - e t a g - -
-  0x00, 0x06, 0x65, 0x78, 0x70, 0x65, 0x63, 0x74,  // - - e x p e c t
-  0x00, 0x00, 0x00, 0x07, 0x65, 0x78, 0x70, 0x69,  // - - - - e x p i
-  0x72, 0x65, 0x73, 0x00, 0x00, 0x00, 0x04, 0x66,  // r e s - - - - f
-  0x72, 0x6f, 0x6d, 0x00, 0x00, 0x00, 0x04, 0x68,  // r o m - - - - h
-  0x6f, 0x73, 0x74, 0x00, 0x00, 0x00, 0x08, 0x69,  // o s t - - - - i
-  0x66, 0x2d, 0x6d, 0x61, 0x74, 0x63, 0x68, 0x00,  // f - m a t c h -
-  0x00, 0x00, 0x11, 0x69, 0x66, 0x2d, 0x6d, 0x6f,  // - - - i f - m o
-  0x64, 0x69, 0x66, 0x69, 0x65, 0x64, 0x2d, 0x73,  // d i f i e d - s
-  0x69, 0x6e, 0x63, 0x65, 0x00, 0x00, 0x00, 0x0d,  // i n c e - - - -
-  0x69, 0x66, 0x2d, 0x6e, 0x6f, 0x6e, 0x65, 0x2d,  // i f - n o n e -
-  0x6d, 0x61, 0x74, 0x63, 0x68, 0x00, 0x00, 0x00,  // m a t c h - - -
-  0x08, 0x69, 0x66, 0x2d, 0x72, 0x61, 0x6e, 0x67,  // - i f - r a n g
-  0x65, 0x00, 0x00, 0x00, 0x13, 0x69, 0x66, 0x2d,  // e - - - - i f -
-  0x75, 0x6e, 0x6d, 0x6f, 0x64, 0x69, 0x66, 0x69,  // u n m o d i f i
-  0x65, 0x64, 0x2d, 0x73, 0x69, 0x6e, 0x63, 0x65,  // e d - s i n c e
-  0x00, 0x00, 0x00, 0x0d, 0x6c, 0x61, 0x73, 0x74,  // - - - - l a s t
-  0x2d, 0x6d, 0x6f, 0x64, 0x69, 0x66, 0x69, 0x65,  // - m o d i f i e
-  0x64, 0x00, 0x00, 0x00, 0x08, 0x6c, 0x6f, 0x63,  // d - - - - l o c
-  0x61, 0x74, 0x69, 0x6f, 0x6e, 0x00, 0x00, 0x00,  // a t i o n - - -
-  0x0c, 0x6d, 0x61, 0x78, 0x2d, 0x66, 0x6f, 0x72,  // - m a x - f o r
-  0x77, 0x61, 0x72, 0x64, 0x73, 0x00, 0x00, 0x00,  // w a r d s - - -
-  0x06, 0x70, 0x72, 0x61, 0x67, 0x6d, 0x61, 0x00,  // - p r a g m a -
-  0x00, 0x00, 0x12, 0x70, 0x72, 0x6f, 0x78, 0x79,  // - - - p r o x y
-  0x2d, 0x61, 0x75, 0x74, 0x68, 0x65, 0x6e, 0x74,  // - a u t h e n t
-  0x69, 0x63, 0x61, 0x74, 0x65, 0x00, 0x00, 0x00,  // i c a t e - - -
-  0x13, 0x70, 0x72, 0x6f, 0x78, 0x79, 0x2d, 0x61,  // - p r o x y - a
-  0x75, 0x74, 0x68, 0x6f, 0x72, 0x69, 0x7a, 0x61,  // u t h o r i z a
-  0x74, 0x69, 0x6f, 0x6e, 0x00, 0x00, 0x00, 0x05,  // t i o n - - - -
-  0x72, 0x61, 0x6e, 0x67, 0x65, 0x00, 0x00, 0x00,  // r a n g e - - -
-  0x07, 0x72, 0x65, 0x66, 0x65, 0x72, 0x65, 0x72,  // - r e f e r e r
-  0x00, 0x00, 0x00, 0x0b, 0x72, 0x65, 0x74, 0x72,  // - - - - r e t r
-  0x79, 0x2d, 0x61, 0x66, 0x74, 0x65, 0x72, 0x00,  // y - a f t e r -
-  0x00, 0x00, 0x06, 0x73, 0x65, 0x72, 0x76, 0x65,  // - - - s e r v e
-  0x72, 0x00, 0x00, 0x00, 0x02, 0x74, 0x65, 0x00,  // r - - - - t e -
-  0x00, 0x00, 0x07, 0x74, 0x72, 0x61, 0x69, 0x6c,  // - - - t r a i l
-  0x65, 0x72, 0x00, 0x00, 0x00, 0x11, 0x74, 0x72,  // e r - - - - t r
-  0x61, 0x6e, 0x73, 0x66, 0x65, 0x72, 0x2d, 0x65,  // a n s f e r - e
-  0x6e, 0x63, 0x6f, 0x64, 0x69, 0x6e, 0x67, 0x00,  // n c o d i n g -
-  0x00, 0x00, 0x07, 0x75, 0x70, 0x67, 0x72, 0x61,  // - - - u p g r a
-  0x64, 0x65, 0x00, 0x00, 0x00, 0x0a, 0x75, 0x73,  // d e - - - - u s
-  0x65, 0x72, 0x2d, 0x61, 0x67, 0x65, 0x6e, 0x74,  // e r - a g e n t
-  0x00, 0x00, 0x00, 0x04, 0x76, 0x61, 0x72, 0x79,  // - - - - v a r y
-  0x00, 0x00, 0x00, 0x03, 0x76, 0x69, 0x61, 0x00,  // - - - - v i a -
-  0x00, 0x00, 0x07, 0x77, 0x61, 0x72, 0x6e, 0x69,  // - - - w a r n i
-  0x6e, 0x67, 0x00, 0x00, 0x00, 0x10, 0x77, 0x77,  // n g - - - - w w
-  0x77, 0x2d, 0x61, 0x75, 0x74, 0x68, 0x65, 0x6e,  // w - a u t h e n
-  0x74, 0x69, 0x63, 0x61, 0x74, 0x65, 0x00, 0x00,  // t i c a t e - -
-  0x00, 0x06, 0x6d, 0x65, 0x74, 0x68, 0x6f, 0x64,  // - - m e t h o d
-  0x00, 0x00, 0x00, 0x03, 0x67, 0x65, 0x74, 0x00,  // - - - - g e t -
-  0x00, 0x00, 0x06, 0x73, 0x74, 0x61, 0x74, 0x75,  // - - - s t a t u
-  0x73, 0x00, 0x00, 0x00, 0x06, 0x32, 0x30, 0x30,  // s - - - - 2 0 0
-  0x20, 0x4f, 0x4b, 0x00, 0x00, 0x00, 0x07, 0x76,  // - O K - - - - v
-  0x65, 0x72, 0x73, 0x69, 0x6f, 0x6e, 0x00, 0x00,  // e r s i o n - -
-  0x00, 0x08, 0x48, 0x54, 0x54, 0x50, 0x2f, 0x31,  // - - H T T P - 1
-  0x2e, 0x31, 0x00, 0x00, 0x00, 0x03, 0x75, 0x72,  // - 1 - - - - u r
-  0x6c, 0x00, 0x00, 0x00, 0x06, 0x70, 0x75, 0x62,  // l - - - - p u b
-  0x6c, 0x69, 0x63, 0x00, 0x00, 0x00, 0x0a, 0x73,  // l i c - - - - s
-  0x65, 0x74, 0x2d, 0x63, 0x6f, 0x6f, 0x6b, 0x69,  // e t - c o o k i
-  0x65, 0x00, 0x00, 0x00, 0x0a, 0x6b, 0x65, 0x65,  // e - - - - k e e
-  0x70, 0x2d, 0x61, 0x6c, 0x69, 0x76, 0x65, 0x00,  // p - a l i v e -
-  0x00, 0x00, 0x06, 0x6f, 0x72, 0x69, 0x67, 0x69,  // - - - o r i g i
-  0x6e, 0x31, 0x30, 0x30, 0x31, 0x30, 0x31, 0x32,  // n 1 0 0 1 0 1 2
-  0x30, 0x31, 0x32, 0x30, 0x32, 0x32, 0x30, 0x35,  // 0 1 2 0 2 2 0 5
-  0x32, 0x30, 0x36, 0x33, 0x30, 0x30, 0x33, 0x30,  // 2 0 6 3 0 0 3 0
-  0x32, 0x33, 0x30, 0x33, 0x33, 0x30, 0x34, 0x33,  // 2 3 0 3 3 0 4 3
-  0x30, 0x35, 0x33, 0x30, 0x36, 0x33, 0x30, 0x37,  // 0 5 3 0 6 3 0 7
-  0x34, 0x30, 0x32, 0x34, 0x30, 0x35, 0x34, 0x30,  // 4 0 2 4 0 5 4 0
-  0x36, 0x34, 0x30, 0x37, 0x34, 0x30, 0x38, 0x34,  // 6 4 0 7 4 0 8 4
-  0x30, 0x39, 0x34, 0x31, 0x30, 0x34, 0x31, 0x31,  // 0 9 4 1 0 4 1 1
-  0x34, 0x31, 0x32, 0x34, 0x31, 0x33, 0x34, 0x31,  // 4 1 2 4 1 3 4 1
-  0x34, 0x34, 0x31, 0x35, 0x34, 0x31, 0x36, 0x34,  // 4 4 1 5 4 1 6 4
-  0x31, 0x37, 0x35, 0x30, 0x32, 0x35, 0x30, 0x34,  // 1 7 5 0 2 5 0 4
-  0x35, 0x30, 0x35, 0x32, 0x30, 0x33, 0x20, 0x4e,  // 5 0 5 2 0 3 - N
-  0x6f, 0x6e, 0x2d, 0x41, 0x75, 0x74, 0x68, 0x6f,  // o n - A u t h o
-  0x72, 0x69, 0x74, 0x61, 0x74, 0x69, 0x76, 0x65,  // r i t a t i v e
-  0x20, 0x49, 0x6e, 0x66, 0x6f, 0x72, 0x6d, 0x61,  // - I n f o r m a
-  0x74, 0x69, 0x6f, 0x6e, 0x32, 0x30, 0x34, 0x20,  // t i o n 2 0 4 -
-  0x4e, 0x6f, 0x20, 0x43, 0x6f, 0x6e, 0x74, 0x65,  // N o - C o n t e
-  0x6e, 0x74, 0x33, 0x30, 0x31, 0x20, 0x4d, 0x6f,  // n t 3 0 1 - M o
-  0x76, 0x65, 0x64, 0x20, 0x50, 0x65, 0x72, 0x6d,  // v e d - P e r m
-  0x61, 0x6e, 0x65, 0x6e, 0x74, 0x6c, 0x79, 0x34,  // a n e n t l y 4
-  0x30, 0x30, 0x20, 0x42, 0x61, 0x64, 0x20, 0x52,  // 0 0 - B a d - R
-  0x65, 0x71, 0x75, 0x65, 0x73, 0x74, 0x34, 0x30,  // e q u e s t 4 0
-  0x31, 0x20, 0x55, 0x6e, 0x61, 0x75, 0x74, 0x68,  // 1 - U n a u t h
-  0x6f, 0x72, 0x69, 0x7a, 0x65, 0x64, 0x34, 0x30,  // o r i z e d 4 0
-  0x33, 0x20, 0x46, 0x6f, 0x72, 0x62, 0x69, 0x64,  // 3 - F o r b i d
-  0x64, 0x65, 0x6e, 0x34, 0x30, 0x34, 0x20, 0x4e,  // d e n 4 0 4 - N
-  0x6f, 0x74, 0x20, 0x46, 0x6f, 0x75, 0x6e, 0x64,  // o t - F o u n d
-  0x35, 0x30, 0x30, 0x20, 0x49, 0x6e, 0x74, 0x65,  // 5 0 0 - I n t e
-  0x72, 0x6e, 0x61, 0x6c, 0x20, 0x53, 0x65, 0x72,  // r n a l - S e r
-  0x76, 0x65, 0x72, 0x20, 0x45, 0x72, 0x72, 0x6f,  // v e r - E r r o
-  0x72, 0x35, 0x30, 0x31, 0x20, 0x4e, 0x6f, 0x74,  // r 5 0 1 - N o t
-  0x20, 0x49, 0x6d, 0x70, 0x6c, 0x65, 0x6d, 0x65,  // - I m p l e m e
-  0x6e, 0x74, 0x65, 0x64, 0x35, 0x30, 0x33, 0x20,  // n t e d 5 0 3 -
-  0x53, 0x65, 0x72, 0x76, 0x69, 0x63, 0x65, 0x20,  // S e r v i c e -
-  0x55, 0x6e, 0x61, 0x76, 0x61, 0x69, 0x6c, 0x61,  // U n a v a i l a
-  0x62, 0x6c, 0x65, 0x4a, 0x61, 0x6e, 0x20, 0x46,  // b l e J a n - F
-  0x65, 0x62, 0x20, 0x4d, 0x61, 0x72, 0x20, 0x41,  // e b - M a r - A
-  0x70, 0x72, 0x20, 0x4d, 0x61, 0x79, 0x20, 0x4a,  // p r - M a y - J
-  0x75, 0x6e, 0x20, 0x4a, 0x75, 0x6c, 0x20, 0x41,  // u n - J u l - A
-  0x75, 0x67, 0x20, 0x53, 0x65, 0x70, 0x74, 0x20,  // u g - S e p t -
-  0x4f, 0x63, 0x74, 0x20, 0x4e, 0x6f, 0x76, 0x20,  // O c t - N o v -
-  0x44, 0x65, 0x63, 0x20, 0x30, 0x30, 0x3a, 0x30,  // D e c - 0 0 - 0
-  0x30, 0x3a, 0x30, 0x30, 0x20, 0x4d, 0x6f, 0x6e,  // 0 - 0 0 - M o n
-  0x2c, 0x20, 0x54, 0x75, 0x65, 0x2c, 0x20, 0x57,  // - - T u e - - W
-  0x65, 0x64, 0x2c, 0x20, 0x54, 0x68, 0x75, 0x2c,  // e d - - T h u -
-  0x20, 0x46, 0x72, 0x69, 0x2c, 0x20, 0x53, 0x61,  // - F r i - - S a
-  0x74, 0x2c, 0x20, 0x53, 0x75, 0x6e, 0x2c, 0x20,  // t - - S u n - -
-  0x47, 0x4d, 0x54, 0x63, 0x68, 0x75, 0x6e, 0x6b,  // G M T c h u n k
-  0x65, 0x64, 0x2c, 0x74, 0x65, 0x78, 0x74, 0x2f,  // e d - t e x t -
-  0x68, 0x74, 0x6d, 0x6c, 0x2c, 0x69, 0x6d, 0x61,  // h t m l - i m a
-  0x67, 0x65, 0x2f, 0x70, 0x6e, 0x67, 0x2c, 0x69,  // g e - p n g - i
-  0x6d, 0x61, 0x67, 0x65, 0x2f, 0x6a, 0x70, 0x67,  // m a g e - j p g
-  0x2c, 0x69, 0x6d, 0x61, 0x67, 0x65, 0x2f, 0x67,  // - i m a g e - g
-  0x69, 0x66, 0x2c, 0x61, 0x70, 0x70, 0x6c, 0x69,  // i f - a p p l i
-  0x63, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x2f, 0x78,  // c a t i o n - x
-  0x6d, 0x6c, 0x2c, 0x61, 0x70, 0x70, 0x6c, 0x69,  // m l - a p p l i
-  0x63, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x2f, 0x78,  // c a t i o n - x
-  0x68, 0x74, 0x6d, 0x6c, 0x2b, 0x78, 0x6d, 0x6c,  // h t m l - x m l
-  0x2c, 0x74, 0x65, 0x78, 0x74, 0x2f, 0x70, 0x6c,  // - t e x t - p l
-  0x61, 0x69, 0x6e, 0x2c, 0x74, 0x65, 0x78, 0x74,  // a i n - t e x t
-  0x2f, 0x6a, 0x61, 0x76, 0x61, 0x73, 0x63, 0x72,  // - j a v a s c r
-  0x69, 0x70, 0x74, 0x2c, 0x70, 0x75, 0x62, 0x6c,  // i p t - p u b l
-  0x69, 0x63, 0x70, 0x72, 0x69, 0x76, 0x61, 0x74,  // i c p r i v a t
-  0x65, 0x6d, 0x61, 0x78, 0x2d, 0x61, 0x67, 0x65,  // e m a x - a g e
-  0x3d, 0x67, 0x7a, 0x69, 0x70, 0x2c, 0x64, 0x65,  // - g z i p - d e
-  0x66, 0x6c, 0x61, 0x74, 0x65, 0x2c, 0x73, 0x64,  // f l a t e - s d
-  0x63, 0x68, 0x63, 0x68, 0x61, 0x72, 0x73, 0x65,  // c h c h a r s e
-  0x74, 0x3d, 0x75, 0x74, 0x66, 0x2d, 0x38, 0x63,  // t - u t f - 8 c
-  0x68, 0x61, 0x72, 0x73, 0x65, 0x74, 0x3d, 0x69,  // h a r s e t - i
-  0x73, 0x6f, 0x2d, 0x38, 0x38, 0x35, 0x39, 0x2d,  // s o - 8 8 5 9 -
-  0x31, 0x2c, 0x75, 0x74, 0x66, 0x2d, 0x2c, 0x2a,  // 1 - u t f - - -
-  0x2c, 0x65, 0x6e, 0x71, 0x3d, 0x30, 0x2e         // - e n q - 0 -
-};
+/* Calls to inflate(), and what they produced. */
+typedef struct _spdy_inflate_counters_t {
+  guint64 calls;
+  guint64 bytes;
+  gdouble seconds;   /* only measured while -z spdy,perf is on */
+} spdy_inflate_counters_t;
 
-static void reset_decompressors(void) {
-  if (spdy_debug) printf("Should reset SPDY decompressors\n");
+/*
+ * Counters on the dissector's own work over the whole capture, reported
+ * by -z spdy,perf and reset in reinit_spdy().
+ */
+typedef struct _spdy_perf_counters_t {
+  spdy_inflate_counters_t header_inflate;
+  spdy_inflate_counters_t body_inflate;
+  guint64 header_blocks_cached;
+  guint64 header_bytes_cached;
+  guint64 header_blocks_from_cache;
+  guint64 retained_bytes_peak;
+  guint64 conversations;
+  guint   conversations_inflating;
+  guint   conversations_inflating_peak;
+  guint64 streams;
+  guint   streams_live;
+  guint   streams_live_peak;
+} spdy_perf_counters_t;
+
+static spdy_perf_counters_t spdy_perf;
+
+/* Times inflate() calls; only there while -z spdy,perf is on. */
+static GTimer *spdy_perf_timer = NULL;
+
+/*
+ * Upper bound, in kilobytes, on the entity body data kept in memory, for
+ * bodies still arriving and finished ones alike; past it, the oldest
+ * bodies are dropped. 0 means no limit.
+ */
+static guint spdy_max_body_memory = 0;
+
+/*
+ * Size, in kilobytes, above which entity bodies are spooled to temporary
+ * files; 0 means never.
+ */
+static guint spdy_spool_threshold = 0;
+
+/*
+ * Media types whose entity bodies are reassembled and decoded, and those
+ * whose bodies aren't, as comma-separated lists; a subtype of "*" stands
+ * for all subtypes. An empty list of wanted types means all of them.
+ */
+static const char *spdy_body_wanted_types = "";
+static const char *spdy_body_unwanted_types = "";
+
+/*
+ * Size, in kilobytes, past which an entity body is no longer kept and only
+ * its DATA frames are counted; 0 means no limit.
+ */
+static guint spdy_max_body_size = 0;
+
+/*
+ * Directory holding header block cache files (see spdy_header_cache_t);
+ * empty means no cache.
+ */
+static const char *spdy_header_cache_dir = "";
+
+/*
+ * All conversations seen in the current capture, so that the stream
+ * tables hanging off of them can be released when the capture is closed.
+ */
+static GSList *spdy_conversations = NULL;
+
+/*
+ * Stands in for conversation data on TCP conversations that the heuristic
+ * dissector has found not to be SPDY.
+ */
+static const char spdy_not_spdy[] = "not SPDY";
+
+/* Per-frame state (spdy_frame_info_t), keyed by frame. */
+static GHashTable *spdy_frame_infos = NULL;
+
+/* spdy_data_continuation_t, keyed by segment. */
+static GHashTable *spdy_data_continuations = NULL;
+
+/* The number of streams indexed so far. */
+static guint32 spdy_stream_count = 0;
+
+/* Entity body data (spdy_body_t), keyed by ID. */
+static GHashTable *spdy_bodies = NULL;
+
+/* The number of entity bodies kept so far; gives them their IDs. */
+static guint32 spdy_body_count = 0;
+
+/*
+ * Entity bodies holding data in memory, oldest first, and the total amount
+ * of data they hold.
+ */
+static GQueue spdy_retained_bodies = G_QUEUE_INIT;
+static guint64 spdy_retained_body_bytes = 0;
+
+/* The spool files created for the current capture, to be removed with it. */
+static GSList *spdy_spool_files = NULL;
+
+/*
+ * Header block inflaters no longer in use, kept for reuse rather than
+ * torn down and set up again; at most SPDY_DECOMPRESSOR_POOL_SIZE.
+ */
+static GSList *spdy_decompressor_pool = NULL;
+static guint spdy_decompressor_pool_len = 0;
+
+/*
+ * Returns a header block inflater in its initial state, or NULL if one
+ * could not be set up.
+ */
+static z_streamp spdy_get_decompressor(void) {
+  z_streamp decomp;
+
+  if (spdy_decompressor_pool != NULL) {
+    decomp = spdy_decompressor_pool->data;
+    spdy_decompressor_pool = g_slist_delete_link(spdy_decompressor_pool,
+                                                 spdy_decompressor_pool);
+    spdy_decompressor_pool_len--;
+    if (inflateReset(decomp) == Z_OK) {
+      return decomp;
+    }
+    spdy_free_header_inflater(decomp);
+  }
+  decomp = spdy_new_header_inflater();
+  if (decomp == NULL && spdy_debug) {
+    printf("inflateInit() failed\n");
+  }
+  return decomp;
 }
 
 /*
- * Returns conversation data for a given packet. If conversation data can't be
- * found, creates and returns new conversation data.
+ * Returns a header block inflater to the pool, or releases it if the pool
+ * is full.
  */
-static spdy_conv_t * get_or_create_spdy_conversation_data(packet_info *pinfo) {
-  conversation_t  *conversation;
-  spdy_conv_t *conv_data;
+static void spdy_put_decompressor(z_streamp decomp) {
+  if (decomp == NULL) {
+    return;
+  }
+  if (spdy_decompressor_pool_len < SPDY_DECOMPRESSOR_POOL_SIZE) {
+    spdy_decompressor_pool = g_slist_prepend(spdy_decompressor_pool, decomp);
+    spdy_decompressor_pool_len++;
+  } else {
+    spdy_free_header_inflater(decomp);
+  }
+}
+
+/*
+ * Calls inflate(), counting the call and its output, and timing it if
+ * asked to.
+ */
+static int spdy_counted_inflate(z_streamp decomp, int flush,
+                                spdy_inflate_counters_t *counters) {
+  uLong total_out = decomp->total_out;
+  gdouble start = 0;
   int retcode;
 
-  conversation = find_conversation(pinfo->fd->num,
-                                   &pinfo->src,
-                                   &pinfo->dst,
-                                   pinfo->ptype,
-                                   pinfo->srcport,
-                                   pinfo->destport,
-                                   0);
+  if (spdy_perf_timer != NULL) {
+    start = g_timer_elapsed(spdy_perf_timer, NULL);
+  }
+  retcode = inflate(decomp, flush);
+  if (spdy_perf_timer != NULL) {
+    counters->seconds += g_timer_elapsed(spdy_perf_timer, NULL) - start;
+  }
+  counters->calls++;
+  counters->bytes += decomp->total_out - total_out;
+  return retcode;
+}
 
-  if (!conversation)  /* Conversation does not exist yet - create it */
-    conversation = conversation_new(pinfo->fd->num,
-                                    &pinfo->src,
-                                    &pinfo->dst,
-                                    pinfo->ptype,
-                                    pinfo->srcport,
-                                    pinfo->destport,
-                                    0);
+static int spdy_counted_header_inflate(z_streamp decomp, int flush,
+                                       gpointer user_data _U_) {
+  return spdy_counted_inflate(decomp, flush, &spdy_perf.header_inflate);
+}
 
-  /* Retrieve information from conversation */
-  conv_data = conversation_get_proto_data(conversation, proto_spdy);
-  if (!conv_data) {
-    /* Set up the conversation structure itself */
-    conv_data = se_alloc0(sizeof(spdy_conv_t));
+/*
+ * Gives up a conversation's header block inflaters. Any header blocks it
+ * has yet to see can no longer be decompressed.
+ */
+static void spdy_release_decompressors(spdy_conv_t *conv_data) {
+  GSList *list;
+
+  if (conv_data->rqst_decompressor != NULL ||
+      conv_data->rply_decompressor != NULL) {
+    spdy_perf.conversations_inflating--;
+  }
+  spdy_put_decompressor(conv_data->rqst_decompressor);
+  spdy_put_decompressor(conv_data->rply_decompressor);
+  conv_data->rqst_decompressor = NULL;
+  conv_data->rply_decompressor = NULL;
+  conv_data->decompressors_released = TRUE;
+  /* With no inflaters left, blocks read from the cache can't be redone. */
+  for (list = conv_data->cached_blocks; list != NULL;
+       list = g_slist_next(list)) {
+    g_free(list->data);
+  }
+  g_slist_free(conv_data->cached_blocks);
+  conv_data->cached_blocks = NULL;
+}
+
+/*
+ * Fills in the key for whatever starts at the given offset in tvb.
+ */
+static void spdy_frame_key_init(spdy_frame_key_t *key,
+                                tvbuff_t *tvb,
+                                packet_info *pinfo,
+                                int offset) {
+  GSList *src;
+  guint32 source = 0;
+
+  for (src = pinfo->data_src; src != NULL; src = g_slist_next(src)) {
+    if (((data_source *)src->data)->tvb == tvb->ds_tvb) {
+      break;
+    }
+    ++source;
+  }
+  key->framenum = pinfo->fd->num;
+  key->source = source;
+  key->offset = tvb_offset_from_real_beginning(tvb) + offset;
+}
+
+/*
+ * Inflated header blocks, cached on disk across dissections of the same
+ * capture so that later ones need not inflate them again.
+ *
+ * The dissector can't see the capture file, so a cache file is named for
+ * the first header block to be inflated: its frame number and time stamp
+ * and the start of its segment. Each block is stored with the compressed
+ * block it came from, which must match byte for byte before the cached
+ * copy is used. The file is written in native byte order, as a header, the
+ * stored blocks, an index of spdy_header_cache_rec_t sorted by frame key,
+ * and a table of spdy_header_cache_conv_t sorted by conversation; it is
+ * mapped into memory to be read, and cached blocks are used right out of
+ * the mapping.
+ *
+ * A header block can only be inflated after every earlier one sent the
+ * same way, so a conversation's blocks are read from the cache only if
+ * the file marks it complete: all its blocks were stored and none of its
+ * streams was left open when the pass that wrote them ended. A pass cut
+ * short between streams, as by tshark -c or a stopped load, can't be told
+ * from one that reached the end of the capture, so should a conversation
+ * turn out to have a block that isn't cached, the blocks already read for
+ * it are inflated over again from its start and the rest of it inflated
+ * as usual; the cache file is then removed, to be written afresh next
+ * time.
+ */
+#define SPDY_HEADER_CACHE_MAGIC "SPDYHC03"
+#define SPDY_HEADER_CACHE_BYTE_ORDER 0x01020304
+#define SPDY_HEADER_CACHE_FINGERPRINT_BYTES 256
+
+typedef struct _spdy_header_cache_file_header_t {
+  char    magic[8];
+  guint32 byte_order;
+  guint32 num_records;
+  guint64 index_offset;
+  guint64 conv_offset;
+  guint32 num_convs;
+  guint32 reserved;
+} spdy_header_cache_file_header_t;
+
+/* A stored block: the compressed block, then its inflated copy. */
+typedef struct _spdy_header_cache_rec_t {
+  spdy_frame_key_t key;
+  guint32 conv;           /* first_frame of its conversation */
+  guint32 comp_length;
+  guint32 uncomp_length;
+  guint32 data_offset;
+} spdy_header_cache_rec_t;
+
+typedef struct _spdy_header_cache_conv_t {
+  guint32 conv;           /* first_frame */
+  guint32 complete;
+} spdy_header_cache_conv_t;
+
+typedef struct _spdy_header_cache_t {
+  gboolean looked_up;     /* for the capture being dissected */
+  /* A cache file that was found */
+  GMappedFile *map;
+  const spdy_header_cache_rec_t *index;
+  guint32 num_records;
+  const spdy_header_cache_conv_t *convs;
+  guint32 num_convs;
+  gboolean stale;         /* some conversation wasn't all there */
+  /* Or one being written, on the first pass */
+  FILE *out;
+  gchar *path;
+  gchar *tmp_path;
+  GArray *records;
+  guint64 out_length;
+  gboolean out_failed;
+} spdy_header_cache_t;
+
+/* A header block read from the cache, kept until its conversation's end. */
+typedef struct _spdy_cached_block_t {
+  spdy_frame_info_t *frame_info;
+  z_streamp *decomp_slot;
+  const guint8 *comp;     /* in the mapping */
+  guint32 comp_length;
+} spdy_cached_block_t;
+
+static spdy_header_cache_t spdy_header_cache;
+
+/*
+ * Maps a cache file, if there is one and it's sound.
+ */
+static gboolean spdy_header_cache_map(const gchar *path) {
+  const spdy_header_cache_file_header_t *hdr;
+  GMappedFile *map;
+  gsize length;
+
+  map = g_mapped_file_new(path, FALSE, NULL);
+  if (map == NULL) {
+    return FALSE;
+  }
+  length = g_mapped_file_get_length(map);
+  hdr = (const spdy_header_cache_file_header_t *)
+      g_mapped_file_get_contents(map);
+  if (length < sizeof(*hdr) ||
+      memcmp(hdr->magic, SPDY_HEADER_CACHE_MAGIC, sizeof(hdr->magic)) != 0 ||
+      hdr->byte_order != SPDY_HEADER_CACHE_BYTE_ORDER ||
+      hdr->index_offset % sizeof(guint64) != 0 ||
+      hdr->index_offset > length ||
+      (length - hdr->index_offset) / sizeof(spdy_header_cache_rec_t) <
+      hdr->num_records ||
+      hdr->conv_offset % sizeof(guint32) != 0 ||
+      hdr->conv_offset > length ||
+      (length - hdr->conv_offset) / sizeof(spdy_header_cache_conv_t) <
+      hdr->num_convs) {
+    if (spdy_debug) {
+      printf("Ignoring bad header cache file %s\n", path);
+    }
+    g_mapped_file_free(map);
+    return FALSE;
+  }
+  spdy_header_cache.map = map;
+  spdy_header_cache.index = (const spdy_header_cache_rec_t *)
+      ((const guint8 *)hdr + hdr->index_offset);
+  spdy_header_cache.num_records = hdr->num_records;
+  spdy_header_cache.convs = (const spdy_header_cache_conv_t *)
+      ((const guint8 *)hdr + hdr->conv_offset);
+  spdy_header_cache.num_convs = hdr->num_convs;
+  if (spdy_debug) {
+    printf("Using %u cached header blocks from %s\n", hdr->num_records, path);
+  }
+  return TRUE;
+}
+
+/*
+ * Looks for the capture's cache file on the first header block that needs
+ * inflating, and starts writing one if there is none. The block and its
+ * segment identify the capture.
+ */
+static void spdy_header_cache_open(packet_info *pinfo, tvbuff_t *tvb) {
+  spdy_header_cache_file_header_t hdr;
+  guint8 *fingerprint;
+  guint fingerprint_len;
+  guint32 stamp[4];
+  guint32 crc;
+  guint32 adler;
+  gchar *name;
+
+  spdy_header_cache.looked_up = TRUE;
+  if (spdy_header_cache_dir == NULL || spdy_header_cache_dir[0] == '\0') {
+    return;
+  }
+
+  stamp[0] = pinfo->fd->num;
+  stamp[1] = (guint32)pinfo->fd->abs_ts.secs;
+  stamp[2] = (guint32)pinfo->fd->abs_ts.nsecs;
+  stamp[3] = tvb_length(tvb);
+  fingerprint_len = MIN(stamp[3], SPDY_HEADER_CACHE_FINGERPRINT_BYTES);
+  fingerprint = tvb_memdup(tvb, 0, fingerprint_len);
+  crc = crc32(crc32(0, (Bytef *)stamp, sizeof(stamp)), fingerprint,
+              fingerprint_len);
+  adler = adler32(adler32(1, (Bytef *)stamp, sizeof(stamp)), fingerprint,
+                  fingerprint_len);
+  g_free(fingerprint);
+
+  name = g_strdup_printf("spdy-%08x%08x.hdrcache", crc, adler);
+  spdy_header_cache.path = g_build_filename(spdy_header_cache_dir, name,
+                                            NULL);
+  g_free(name);
+  if (spdy_header_cache_map(spdy_header_cache.path)) {
+    return;
+  }
+
+  spdy_header_cache.tmp_path = g_strdup_printf("%s.tmp",
+                                               spdy_header_cache.path);
+  spdy_header_cache.out = ws_fopen(spdy_header_cache.tmp_path, "wb");
+  if (spdy_header_cache.out == NULL) {
+    if (spdy_debug) {
+      printf("Can't write header cache file %s: %s\n",
+             spdy_header_cache.tmp_path, g_strerror(errno));
+    }
+    return;
+  }
+  /* Filled in once the index is written. */
+  memset(&hdr, 0, sizeof(hdr));
+  if (fwrite(&hdr, sizeof(hdr), 1, spdy_header_cache.out) != 1) {
+    spdy_header_cache.out_failed = TRUE;
+  }
+  spdy_header_cache.out_length = sizeof(hdr);
+  spdy_header_cache.records = g_array_new(FALSE, FALSE,
+                                          sizeof(spdy_header_cache_rec_t));
+}
+
+static int spdy_header_cache_rec_compare(const void *a, const void *b) {
+  const spdy_header_cache_rec_t *ra = a;
+  const spdy_header_cache_rec_t *rb = b;
+
+  if (ra->key.framenum != rb->key.framenum) {
+    return ra->key.framenum < rb->key.framenum ? -1 : 1;
+  }
+  if (ra->key.source != rb->key.source) {
+    return ra->key.source < rb->key.source ? -1 : 1;
+  }
+  if (ra->key.offset != rb->key.offset) {
+    return ra->key.offset < rb->key.offset ? -1 : 1;
+  }
+  return 0;
+}
+
+static int spdy_header_cache_conv_compare(const void *a, const void *b) {
+  const spdy_header_cache_conv_t *ca = a;
+  const spdy_header_cache_conv_t *cb = b;
+
+  if (ca->conv != cb->conv) {
+    return ca->conv < cb->conv ? -1 : 1;
+  }
+  return 0;
+}
+
+/*
+ * Decides, on a conversation's first header block, whether its blocks can
+ * be read from the cache file.
+ */
+static spdy_header_cache_use_t spdy_header_cache_use(
+    const spdy_conv_t *conv_data) {
+  spdy_header_cache_conv_t key;
+  const spdy_header_cache_conv_t *conv;
+
+  if (spdy_header_cache.map == NULL) {
+    return SPDY_HEADER_CACHE_INFLATING;
+  }
+  key.conv = conv_data->first_frame;
+  conv = bsearch(&key, spdy_header_cache.convs, spdy_header_cache.num_convs,
+                 sizeof(spdy_header_cache_conv_t),
+                 spdy_header_cache_conv_compare);
+  if (conv == NULL || !conv->complete) {
+    return SPDY_HEADER_CACHE_INFLATING;
+  }
+  return SPDY_HEADER_CACHE_READING;
+}
+
+/*
+ * Returns the record of the cached copy of the header block at the given
+ * offset in tvb, whose frame's payload starts at payload_offset, or NULL
+ * if there isn't one.
+ */
+static const spdy_header_cache_rec_t *spdy_header_cache_lookup(
+    packet_info *pinfo,
+    int payload_offset,
+    tvbuff_t *tvb,
+    int offset,
+    guint32 length,
+    const spdy_conv_t *conv_data) {
+  spdy_header_cache_rec_t key;
+  const spdy_header_cache_rec_t *rec;
+  const guint8 *contents;
+
+  spdy_frame_key_init(&key.key, tvb, pinfo, payload_offset);
+  rec = bsearch(&key, spdy_header_cache.index, spdy_header_cache.num_records,
+                sizeof(spdy_header_cache_rec_t),
+                spdy_header_cache_rec_compare);
+  if (rec == NULL || rec->conv != conv_data->first_frame ||
+      rec->comp_length != length ||
+      (guint64)rec->data_offset + rec->comp_length + rec->uncomp_length >
+      g_mapped_file_get_length(spdy_header_cache.map)) {
+    return NULL;
+  }
+  contents = (const guint8 *)g_mapped_file_get_contents(spdy_header_cache.map);
+  if (memcmp(contents + rec->data_offset, tvb_get_ptr(tvb, offset, length),
+             length) != 0) {
+    return NULL;
+  }
+  return rec;
+}
+
+/*
+ * Adds a freshly inflated header block to the cache file being written.
+ */
+static void spdy_header_cache_store(packet_info *pinfo,
+                                    int payload_offset,
+                                    tvbuff_t *tvb,
+                                    int offset,
+                                    guint32 length,
+                                    const spdy_conv_t *conv_data,
+                                    const guint8 *uncomp,
+                                    guint uncomp_length) {
+  spdy_header_cache_rec_t rec;
+
+  if (spdy_header_cache.out == NULL || spdy_header_cache.out_failed) {
+    return;
+  }
+  if (spdy_header_cache.out_length + length + uncomp_length > G_MAXUINT32) {
+    /* Record offsets are 32 bits; a file short of blocks is no use. */
+    spdy_header_cache.out_failed = TRUE;
+    return;
+  }
+  spdy_frame_key_init(&rec.key, tvb, pinfo, payload_offset);
+  rec.conv = conv_data->first_frame;
+  rec.comp_length = length;
+  rec.uncomp_length = uncomp_length;
+  rec.data_offset = (guint32)spdy_header_cache.out_length;
+  if (fwrite(tvb_get_ptr(tvb, offset, length), 1, length,
+             spdy_header_cache.out) != length ||
+      fwrite(uncomp, 1, uncomp_length, spdy_header_cache.out) !=
+      uncomp_length) {
+    spdy_header_cache.out_failed = TRUE;
+    return;
+  }
+  spdy_header_cache.out_length += length + uncomp_length;
+  g_array_append_val(spdy_header_cache.records, rec);
+}
+
+/*
+ * Finishes the cache file being written once a first pass is done, and
+ * puts it in place; or removes a cache file that turned out to be short.
+ */
+static void spdy_header_cache_finish(void) {
+  static const guint8 padding[sizeof(guint64)];
+  spdy_header_cache_file_header_t hdr;
+  FILE *out = spdy_header_cache.out;
+  GArray *records = spdy_header_cache.records;
+  GArray *convs;
+  GSList *convlist;
+  gboolean ok;
+  guint pad;
+
+  if (spdy_header_cache.map != NULL && spdy_header_cache.stale) {
+    /* The mapping stays usable until the capture is closed. */
+    ws_unlink(spdy_header_cache.path);
+    if (spdy_debug) {
+      printf("Removed short header cache file %s\n", spdy_header_cache.path);
+    }
+  }
+  if (out == NULL) {
+    return;
+  }
+  spdy_header_cache.out = NULL;
+
+  convs = g_array_new(FALSE, FALSE, sizeof(spdy_header_cache_conv_t));
+  for (convlist = spdy_conversations; convlist != NULL;
+       convlist = g_slist_next(convlist)) {
+    const spdy_conv_t *conv_data = convlist->data;
+    spdy_header_cache_conv_t conv;
+
+    conv.conv = conv_data->first_frame;
+    conv.complete = !conv_data->cache_incomplete &&
+        conv_data->open_streams[0] == 0 && conv_data->open_streams[1] == 0;
+    g_array_append_val(convs, conv);
+  }
+  g_array_sort(convs, spdy_header_cache_conv_compare);
+
+  pad = (guint)((sizeof(guint64) - spdy_header_cache.out_length %
+                 sizeof(guint64)) % sizeof(guint64));
+  g_array_sort(records, spdy_header_cache_rec_compare);
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, SPDY_HEADER_CACHE_MAGIC, sizeof(hdr.magic));
+  hdr.byte_order = SPDY_HEADER_CACHE_BYTE_ORDER;
+  hdr.num_records = records->len;
+  hdr.index_offset = spdy_header_cache.out_length + pad;
+  hdr.num_convs = convs->len;
+  hdr.conv_offset = hdr.index_offset +
+      (guint64)records->len * sizeof(spdy_header_cache_rec_t);
+  ok = !spdy_header_cache.out_failed && records->len > 0 &&
+      fwrite(padding, 1, pad, out) == pad &&
+      fwrite(records->data, sizeof(spdy_header_cache_rec_t), records->len,
+             out) == records->len &&
+      fwrite(convs->data, sizeof(spdy_header_cache_conv_t), convs->len,
+             out) == convs->len &&
+      fseek(out, 0, SEEK_SET) == 0 &&
+      fwrite(&hdr, sizeof(hdr), 1, out) == 1;
+  if (fclose(out) != 0) {
+    ok = FALSE;
+  }
+  if (ok) {
+    /* ws_rename() may not replace an existing file. */
+    ws_unlink(spdy_header_cache.path);
+    ok = ws_rename(spdy_header_cache.tmp_path, spdy_header_cache.path) == 0;
+  }
+  if (!ok) {
+    ws_unlink(spdy_header_cache.tmp_path);
+  }
+  if (spdy_debug) {
+    printf("%s %u header blocks to %s\n", ok ? "Wrote" : "Failed to write",
+           records->len, spdy_header_cache.path);
+  }
+  g_array_free(convs, TRUE);
+  g_array_free(records, TRUE);
+  spdy_header_cache.records = NULL;
+}
+
+/*
+ * Drops the cache state for the capture being closed, along with any cache
+ * file left unfinished.
+ */
+static void spdy_header_cache_close(void) {
+  if (spdy_header_cache.out != NULL) {
+    fclose(spdy_header_cache.out);
+    ws_unlink(spdy_header_cache.tmp_path);
+  }
+  if (spdy_header_cache.records != NULL) {
+    g_array_free(spdy_header_cache.records, TRUE);
+  }
+  if (spdy_header_cache.map != NULL) {
+    g_mapped_file_free(spdy_header_cache.map);
+  }
+  g_free(spdy_header_cache.path);
+  g_free(spdy_header_cache.tmp_path);
+  memset(&spdy_header_cache, 0, sizeof(spdy_header_cache));
+}
+
+/*
+ * Called once a sequential pass over the capture is done. Every header
+ * block has been decompressed and saved by then, so the inflaters are
+ * no longer needed.
+ */
+static void reset_decompressors(void) {
+  GSList *convlist;
+
+  for (convlist = spdy_conversations; convlist != NULL;
+       convlist = g_slist_next(convlist)) {
+    spdy_release_decompressors(convlist->data);
+  }
+  if (spdy_debug) printf("Released SPDY header decompressors\n");
+  spdy_header_cache_finish();
+}
+
+/*
+ * Releases the inflater for a given content-encoded body.
+ */
+static void spdy_end_body_decompressor(spdy_body_sender_t *sender) {
+  if (sender->body_decompressor != NULL) {
+    inflateEnd(sender->body_decompressor);
+    g_free(sender->body_decompressor);
+    sender->body_decompressor = NULL;
+  }
+}
+
+/*
+ * Records the amount of entity body data now held for a given body.
+ */
+static void spdy_set_retained_bytes(spdy_body_t *body, guint nbytes) {
+  if (body->retained_link == NULL && nbytes != 0) {
+    body->retained_link = g_list_alloc();
+    body->retained_link->data = body;
+    g_queue_push_tail_link(&spdy_retained_bodies, body->retained_link);
+  }
+  spdy_retained_body_bytes -= body->retained_bytes;
+  spdy_retained_body_bytes += nbytes;
+  if (spdy_retained_body_bytes > spdy_perf.retained_bytes_peak) {
+    spdy_perf.retained_bytes_peak = spdy_retained_body_bytes;
+  }
+  body->retained_bytes = nbytes;
+  if (body->retained_link != NULL && nbytes == 0) {
+    g_queue_unlink(&spdy_retained_bodies, body->retained_link);
+    g_list_free_1(body->retained_link);
+    body->retained_link = NULL;
+  }
+}
+
+/*
+ * Frees a given body's data; called as it leaves spdy_bodies.
+ */
+static void spdy_free_body(gpointer data) {
+  spdy_body_t *body = data;
+
+  if (body->data != NULL) {
+    g_byte_array_free(body->data, TRUE);
+  }
+  if (body->assembled_data != NULL) {
+    tvb_free(body->assembled_data);
+  }
+  spdy_set_retained_bytes(body, 0);
+  g_free(body);
+}
+
+/*
+ * Retrieves the body data with a given ID, or NULL if there's none or it
+ * has been evicted.
+ */
+static spdy_body_t* spdy_get_body(guint32 body_id) {
+  if (body_id == 0) {
+    return NULL;
+  }
+  return g_hash_table_lookup(spdy_bodies, GUINT_TO_POINTER(body_id));
+}
+
+/*
+ * Returns the body data being kept for a given body, setting it up if
+ * there's none yet. Returns NULL if it has been evicted.
+ */
+static spdy_body_t* spdy_get_sender_body(spdy_body_sender_t *sender) {
+  spdy_body_t *body;
+
+  if (sender->body_id != 0) {
+    return spdy_get_body(sender->body_id);
+  }
+  body = g_malloc0(sizeof(spdy_body_t));
+  body->id = ++spdy_body_count;
+  body->stream_id = sender->stream_id;
+  body->data = g_byte_array_new();
+  g_hash_table_insert(spdy_bodies, GUINT_TO_POINTER(body->id), body);
+  sender->body_id = body->id;
+  return body;
+}
+
+/*
+ * Releases what's held for receiving a given body, the body data included.
+ */
+static void spdy_release_body(spdy_body_sender_t *sender) {
+  if (sender->body_id != 0) {
+    g_hash_table_remove(spdy_bodies, GUINT_TO_POINTER(sender->body_id));
+    sender->body_id = 0;
+  }
+  if (sender->frames != NULL) {
+    g_array_free(sender->frames, TRUE);
+    sender->frames = NULL;
+  }
+  spdy_end_body_decompressor(sender);
+  if (sender->spool != NULL) {
+    fclose(sender->spool);
+    sender->spool = NULL;
+  }
+}
+
+/*
+ * Whether a given body's data has been evicted while it was being
+ * received, in which case the rest of it is only counted.
+ */
+static gboolean spdy_body_evicted(spdy_body_sender_t *sender) {
+  if (!sender->body_evicted && sender->body_id != 0 &&
+      spdy_get_body(sender->body_id) == NULL) {
+    sender->body_evicted = TRUE;
+    spdy_release_body(sender);
+  }
+  return sender->body_evicted;
+}
+
+/*
+ * Moves the body data accumulated so far out to its spool file, starting
+ * one once the body grows past spdy_spool_threshold. Returns FALSE if
+ * writing it failed, and the body was dropped.
+ */
+static gboolean spdy_spool_body_data(spdy_body_sender_t *sender,
+                                     spdy_body_t *body) {
+  if (body->data->len == 0) {
+    return TRUE;
+  }
+  if (sender->spool == NULL) {
+    GError *err = NULL;
+    int fd;
+
+    if (sender->spool_path != NULL || sender->spool_failed ||
+        spdy_spool_threshold == 0 ||
+        body->data->len <= spdy_spool_threshold * 1024) {
+      return TRUE;
+    }
+    fd = g_file_open_tmp("wireshark_spdy_XXXXXX", &sender->spool_path, &err);
+    if (fd != -1) {
+      sender->spool = ws_fdopen(fd, "wb");
+    }
+    if (sender->spool == NULL) {
+      if (spdy_debug) {
+        printf("Can't spool body for stream %u: %s\n", sender->stream_id,
+               err != NULL ? err->message : g_strerror(errno));
+      }
+      if (err != NULL) {
+        g_error_free(err);
+      }
+      if (sender->spool_path != NULL) {
+        ws_unlink(sender->spool_path);
+        g_free(sender->spool_path);
+        sender->spool_path = NULL;
+      }
+      /* Keep the body in memory then. */
+      sender->spool_failed = TRUE;
+      return TRUE;
+    }
+    spdy_spool_files = g_slist_prepend(spdy_spool_files, sender->spool_path);
+    body->spooled = TRUE;
+  }
+  if (fwrite(body->data->data, 1, body->data->len, sender->spool) !=
+      body->data->len) {
+    if (spdy_debug) {
+      printf("Spooling body for stream %u failed: %s\n", sender->stream_id,
+             g_strerror(errno));
+    }
+    spdy_release_body(sender);
+    sender->spool_failed = TRUE;
+    sender->body_evicted = TRUE;
+    return FALSE;
+  }
+  sender->spooled_length += body->data->len;
+  g_byte_array_set_size(body->data, 0);
+  return TRUE;
+}
+
+/*
+ * Drops the oldest entity bodies, whether finished or still being
+ * received, until the body data they retain fits within
+ * spdy_max_body_memory. Returns the number of bodies dropped.
+ */
+static guint spdy_evict_bodies(void) {
+  guint evicted = 0;
+
+  if (spdy_max_body_memory == 0) {
+    return 0;
+  }
+  while (spdy_retained_body_bytes > (guint64)spdy_max_body_memory * 1024 &&
+         !g_queue_is_empty(&spdy_retained_bodies)) {
+    spdy_body_t *body = g_queue_peek_head(&spdy_retained_bodies);
+    if (spdy_debug) {
+      printf("Dropping %u bytes of body data for stream %u\n",
+             body->retained_bytes, body->stream_id);
+    }
+    g_hash_table_remove(spdy_bodies, GUINT_TO_POINTER(body->id));
+    ++evicted;
+  }
+  return evicted;
+}
+
+/*
+ * Frees a given stream and everything it holds.
+ */
+static void spdy_free_stream_info(gpointer data) {
+  spdy_stream_info_t *si = data;
+
+  spdy_release_body(&si->sender[0]);
+  spdy_release_body(&si->sender[1]);
+  g_free(si);
+}
+
+/*
+ * Frees state on a stream that's still in its conversation's table.
+ */
+static void spdy_free_live_stream_info(gpointer data) {
+  spdy_perf.streams_live--;
+  spdy_free_stream_info(data);
+}
+
+static void spdy_free_stream_frames(gpointer data) {
+  spdy_stream_frames_t *sf = data;
+
+  g_array_free(sf->frames, TRUE);
+  g_free(sf);
+}
+
+/*
+ * Returns conversation data for a given packet. If conversation data can't be
+ * found, creates and returns new conversation data.
+ */
+static spdy_conv_t * get_or_create_spdy_conversation_data(packet_info *pinfo) {
+  conversation_t  *conversation;
+  spdy_conv_t *conv_data;
+
+  conversation = find_conversation(pinfo->fd->num,
+                                   &pinfo->src,
+                                   &pinfo->dst,
+                                   pinfo->ptype,
+                                   pinfo->srcport,
+                                   pinfo->destport,
+                                   0);
+
+  if (!conversation)  /* Conversation does not exist yet - create it */
+    conversation = conversation_new(pinfo->fd->num,
+                                    &pinfo->src,
+                                    &pinfo->dst,
+                                    pinfo->ptype,
+                                    pinfo->srcport,
+                                    pinfo->destport,
+                                    0);
+
+  /* Retrieve information from conversation */
+  conv_data = conversation_get_proto_data(conversation, proto_spdy);
+  if (conv_data == (void *)spdy_not_spdy) {
+    /* The heuristic was wrong, or the conversation's been Decoded As. */
+    conversation_delete_proto_data(conversation, proto_spdy);
+    conv_data = NULL;
+  }
+  if (!conv_data) {
+    /* Set up the conversation structure itself */
+    conv_data = g_malloc0(sizeof(spdy_conv_t));
+    conv_data->first_frame = pinfo->fd->num;
+
+    conv_data->streams = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                               NULL,
+                                               spdy_free_live_stream_info);
+    conv_data->pings = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                             NULL, g_free);
+    conv_data->stream_frames = g_hash_table_new_full(g_direct_hash,
+                                                     g_direct_equal, NULL,
+                                                     spdy_free_stream_frames);
+    conv_data->initial_window[0] = SPDY_DEFAULT_INITIAL_WINDOW;
+    conv_data->initial_window[1] = SPDY_DEFAULT_INITIAL_WINDOW;
+    conv_data->conn_window[0] = SPDY_DEFAULT_INITIAL_WINDOW;
+    conv_data->conn_window[1] = SPDY_DEFAULT_INITIAL_WINDOW;
+    spdy_conversations = g_slist_prepend(spdy_conversations, conv_data);
+    spdy_perf.conversations++;
+
+    conversation_add_proto_data(conversation, proto_spdy, conv_data);
+  }
+
+  return conv_data;
+}
+
+/*
+ * Determines which way a frame in a given conversation was sent. This is
+ * known once the client has been seen opening a stream.
+ */
+static spdy_direction_t spdy_get_direction(const spdy_conv_t *conv_data,
+                                           const packet_info *pinfo) {
+  if (!conv_data->client_known) {
+    return SPDY_DIRECTION_UNKNOWN;
+  }
+  if (pinfo->srcport == conv_data->client_port &&
+      ADDRESSES_EQUAL(&pinfo->src, &conv_data->client_addr)) {
+    return SPDY_DIRECTION_TO_SERVER;
+  }
+  return SPDY_DIRECTION_TO_CLIENT;
+}
+
+/*
+ * Returns the state retained on a given stream, creating it if there is
+ * none yet.
+ */
+static spdy_stream_info_t* spdy_get_or_create_stream_info(
+    spdy_conv_t *conv_data,
+    guint32 stream_id) {
+  spdy_stream_info_t *si = g_hash_table_lookup(conv_data->streams,
+                                               GUINT_TO_POINTER(stream_id));
+
+  if (si == NULL) {
+    si = g_malloc0(sizeof(spdy_stream_info_t));
+    si->stream_id = stream_id;
+    si->sender[0].stream_id = stream_id;
+    si->sender[1].stream_id = stream_id;
+    g_hash_table_insert(conv_data->streams, GUINT_TO_POINTER(stream_id), si);
+    spdy_perf.streams++;
+    if (++spdy_perf.streams_live > spdy_perf.streams_live_peak) {
+      spdy_perf.streams_live_peak = spdy_perf.streams_live;
+    }
+    if (spdy_debug) {
+      printf("Saved stream info for ID %u\n", stream_id);
+    }
+  }
+  return si;
+}
+
+/*
+ * Retrieves previously saved state on a given stream.
+ */
+static spdy_stream_info_t* spdy_get_stream_info(spdy_conv_t *conv_data,
+                                                guint32 stream_id) {
+    return g_hash_table_lookup(conv_data->streams, GUINT_TO_POINTER(stream_id));
+}
+
+/*
+ * Returns the index entry for a given stream, first noting, on the first
+ * pass, that the frame being dissected carries it. Returns NULL for
+ * stream 0, and for streams that were never indexed.
+ */
+static const spdy_stream_frames_t* spdy_index_stream_frame(
+    packet_info *pinfo,
+    spdy_conv_t *conv_data,
+    guint32 stream_id) {
+  spdy_stream_frames_t *sf;
+  guint32 framenum = pinfo->fd->num;
+
+  if (stream_id == 0) {
+    return NULL;
+  }
+  sf = g_hash_table_lookup(conv_data->stream_frames,
+                           GUINT_TO_POINTER(stream_id));
+  if (pinfo->fd->flags.visited) {
+    return sf;
+  }
+  if (sf == NULL) {
+    sf = g_malloc(sizeof(spdy_stream_frames_t));
+    sf->index = spdy_stream_count++;
+    sf->frames = g_array_new(FALSE, FALSE, sizeof(guint32));
+    g_hash_table_insert(conv_data->stream_frames, GUINT_TO_POINTER(stream_id),
+                        sf);
+  }
+  if (sf->frames->len == 0 ||
+      g_array_index(sf->frames, guint32, sf->frames->len - 1) != framenum) {
+    g_array_append_val(sf->frames, framenum);
+  }
+  return sf;
+}
+
+/*
+ * Shows which stream of the capture a frame belongs to, and fills in the
+ * stream's index in the frame's tap record.
+ */
+static void spdy_add_stream_index(proto_tree *spdy_tree,
+                                  tvbuff_t *tvb,
+                                  const spdy_stream_frames_t *sf,
+                                  spdy_tap_info_t *tap_info) {
+  if (sf == NULL) {
+    return;
+  }
+  if (spdy_tree) {
+    proto_item *ti = proto_tree_add_uint(spdy_tree, hf_spdy_stream_index, tvb,
+                                         0, 0, sf->index);
+    PROTO_ITEM_SET_GENERATED(ti);
+  }
+  if (tap_info != NULL) {
+    tap_info->has_stream_index = TRUE;
+    tap_info->stream_index = sf->index;
+    tap_info->stream_frames = sf->frames;
+  }
+}
+
+static guint spdy_frame_key_hash(gconstpointer k) {
+  const spdy_frame_key_t *key = (const spdy_frame_key_t *)k;
+
+  return key->framenum ^ (key->source << 24) ^ (key->offset << 8);
+}
+
+static gboolean spdy_frame_key_equal(gconstpointer a, gconstpointer b) {
+  const spdy_frame_key_t *ka = (const spdy_frame_key_t *)a;
+  const spdy_frame_key_t *kb = (const spdy_frame_key_t *)b;
+
+  return ka->framenum == kb->framenum && ka->source == kb->source &&
+      ka->offset == kb->offset;
+}
+
+/*
+ * Creates the saved state for the frame whose payload starts at the given
+ * offset in tvb.
+ */
+static spdy_frame_info_t* spdy_add_frame_info(tvbuff_t *tvb,
+                                              packet_info *pinfo,
+                                              int offset,
+                                              guint32 stream_id,
+                                              guint16 frame_type) {
+  spdy_frame_info_t *frame_info = se_alloc0(sizeof(spdy_frame_info_t));
+  spdy_frame_key_init(&frame_info->key, tvb, pinfo, offset);
+  frame_info->stream_id = stream_id;
+  frame_info->frame_type = frame_type;
+  g_hash_table_insert(spdy_frame_infos, &frame_info->key, frame_info);
+  return frame_info;
+}
+
+/*
+ * Retrieves saved state for the frame whose payload starts at the given
+ * offset in tvb.
+ */
+static spdy_frame_info_t* spdy_get_frame_info(tvbuff_t *tvb,
+                                              packet_info *pinfo,
+                                              int offset) {
+  spdy_frame_key_t key;
+
+  spdy_frame_key_init(&key, tvb, pinfo, offset);
+  return g_hash_table_lookup(spdy_frame_infos, &key);
+}
+
+/*
+ * Notes a newly opened pushed stream, on the first pass, linking it to the
+ * SYN_STREAM of the stream it was pushed for.
+ */
+static void spdy_note_push(tvbuff_t *tvb,
+                           packet_info *pinfo,
+                           spdy_conv_t *conv_data,
+                           spdy_stream_info_t *si,
+                           guint32 associated_stream_id,
+                           int offset) {
+  spdy_stream_frames_t *sf;
+  spdy_frame_info_t *frame_info;
+
+  si->common.is_push = TRUE;
+  si->common.associated_stream_id = associated_stream_id;
+  conv_data->pushes++;
+  sf = g_hash_table_lookup(conv_data->stream_frames,
+                           GUINT_TO_POINTER(associated_stream_id));
+  if (sf == NULL || sf->frames->len == 0) {
+    return;
+  }
+  frame_info = spdy_get_frame_info(tvb, pinfo, offset);
+  if (frame_info == NULL) {
+    frame_info = spdy_add_frame_info(tvb, pinfo, offset, si->stream_id,
+                                     SPDY_SYN_STREAM);
+  }
+  frame_info->push_parent_frame = g_array_index(sf->frames, guint32, 0);
+}
+
+/*
+ * Counts the DATA bytes a pushed stream's server sends, on the first pass.
+ */
+static void spdy_track_push_data(spdy_conv_t *conv_data,
+                                 spdy_stream_info_t *si,
+                                 const spdy_control_frame_info_t *frame) {
+  if (si->common.is_push &&
+      si->common.push_outcome == SPDY_PUSH_PENDING &&
+      conv_data->direction == si->common.opener_direction) {
+    si->common.pushed_bytes += frame->length;
+  }
+}
+
+/*
+ * Records how a pushed stream ended, on the first pass: the bytes of those
+ * that complete were useful, those of ones reset by either side wasted.
+ */
+static void spdy_end_push(tvbuff_t *tvb,
+                          packet_info *pinfo,
+                          spdy_conv_t *conv_data,
+                          spdy_stream_info_t *si,
+                          int offset,
+                          guint16 frame_type,
+                          guint8 outcome,
+                          guint32 rst_status,
+                          spdy_frame_info_t **frame_info) {
+  spdy_stream_common_t *common = &si->common;
+
+  if (!common->is_push || common->push_outcome != SPDY_PUSH_PENDING) {
+    return;
+  }
+  common->push_outcome = outcome;
+  if (outcome == SPDY_PUSH_COMPLETED) {
+    conv_data->push_useful_bytes += common->pushed_bytes;
+  } else {
+    conv_data->pushes_reset++;
+    conv_data->push_wasted_bytes += common->pushed_bytes;
+  }
+  if (*frame_info == NULL) {
+    *frame_info = spdy_add_frame_info(tvb, pinfo, offset, si->stream_id,
+                                      frame_type);
+  }
+  (*frame_info)->push_outcome = outcome;
+  (*frame_info)->push_rst_status = rst_status;
+  (*frame_info)->pushed_bytes = common->pushed_bytes;
+  (*frame_info)->conv_push_useful = conv_data->push_useful_bytes;
+  (*frame_info)->conv_push_wasted = conv_data->push_wasted_bytes;
+}
+
+/*
+ * Adds what is known of a pushed stream: on its SYN_STREAM, the stream it
+ * was pushed for, and on the frame ending it, how it ended.
+ */
+static void spdy_add_push_info(packet_info *pinfo,
+                               proto_tree *tree,
+                               tvbuff_t *tvb,
+                               const spdy_frame_info_t *frame_info) {
+  proto_item *ti;
+
+  if (frame_info == NULL) {
+    return;
+  }
+  if (frame_info->push_parent_frame != 0) {
+    ti = proto_tree_add_uint(tree, hf_spdy_push_parent_frame, tvb, 0, 0,
+                             frame_info->push_parent_frame);
+    PROTO_ITEM_SET_GENERATED(ti);
+  }
+  if (frame_info->push_outcome == SPDY_PUSH_PENDING) {
+    return;
+  }
+  ti = proto_tree_add_uint(tree, hf_spdy_push_outcome, tvb, 0, 0,
+                           frame_info->push_outcome);
+  PROTO_ITEM_SET_GENERATED(ti);
+  if (frame_info->push_outcome != SPDY_PUSH_COMPLETED) {
+    expert_add_info_format(pinfo, ti, PI_SEQUENCE, PI_NOTE,
+                           "Pushed stream %u reset (%s) after %"
+                           G_GINT64_MODIFIER "u bytes",
+                           frame_info->stream_id,
+                           val_to_str(frame_info->push_rst_status,
+                                      rst_stream_status_names,
+                                      "Unknown (%d)"),
+                           frame_info->pushed_bytes);
+  }
+  ti = proto_tree_add_uint64(tree, hf_spdy_pushed_bytes, tvb, 0, 0,
+                             frame_info->pushed_bytes);
+  PROTO_ITEM_SET_GENERATED(ti);
+  ti = proto_tree_add_uint64(tree, hf_spdy_conv_push_useful, tvb, 0, 0,
+                             frame_info->conv_push_useful);
+  PROTO_ITEM_SET_GENERATED(ti);
+  ti = proto_tree_add_uint64(tree, hf_spdy_conv_push_wasted, tvb, 0, 0,
+                             frame_info->conv_push_wasted);
+  PROTO_ITEM_SET_GENERATED(ti);
+}
+
+/*
+ * Counts a newly opened stream among its opener's open streams, on the
+ * first pass, and checks the count against the peer's limit.
+ */
+static void spdy_count_stream_opened(tvbuff_t *tvb,
+                                     packet_info *pinfo,
+                                     spdy_conv_t *conv_data,
+                                     spdy_stream_info_t *si,
+                                     int offset) {
+  const spdy_settings_t *peer_settings;
+  spdy_frame_info_t *frame_info;
+  int idx;
+
+  if (si->common.opener_direction == SPDY_DIRECTION_UNKNOWN ||
+      si->common.counted_open) {
+    return;
+  }
+  idx = si->common.opener_direction - 1;
+  /* A push that's already finished is never open. */
+  if (!(si->common.opener_fin && si->common.unidirectional)) {
+    si->common.counted_open = TRUE;
+    conv_data->open_streams[idx]++;
+  }
+
+  frame_info = spdy_get_frame_info(tvb, pinfo, offset);
+  if (frame_info == NULL) {
+    frame_info = spdy_add_frame_info(tvb, pinfo, offset, si->stream_id,
+                                     SPDY_SYN_STREAM);
+  }
+  frame_info->has_concurrency = TRUE;
+  frame_info->concurrent_streams = conv_data->open_streams[idx];
+  peer_settings = &conv_data->settings[1 - idx];
+  if (peer_settings->present & (1 << SPDY_SETTINGS_MAX_CONCURRENT_STREAMS)) {
+    frame_info->has_concurrency_limit = TRUE;
+    frame_info->concurrency_limit =
+        peer_settings->values[SPDY_SETTINGS_MAX_CONCURRENT_STREAMS];
+  }
+}
+
+/*
+ * Takes a stream that has finished, been reset or been disowned out of its
+ * opener's open streams, on the first pass. If frame_info is given, the
+ * count that leaves is kept with the frame.
+ */
+static void spdy_count_stream_closed(tvbuff_t *tvb,
+                                     packet_info *pinfo,
+                                     spdy_conv_t *conv_data,
+                                     spdy_stream_info_t *si,
+                                     int offset,
+                                     guint16 frame_type,
+                                     spdy_frame_info_t **frame_info) {
+  int idx;
+
+  if (!si->common.counted_open) {
+    return;
+  }
+  si->common.counted_open = FALSE;
+  idx = si->common.opener_direction - 1;
+  conv_data->open_streams[idx]--;
+  if (frame_info == NULL) {
+    return;
+  }
+  if (*frame_info == NULL) {
+    *frame_info = spdy_add_frame_info(tvb, pinfo, offset, si->stream_id,
+                                      frame_type);
+  }
+  (*frame_info)->has_concurrency = TRUE;
+  (*frame_info)->concurrent_streams = conv_data->open_streams[idx];
+}
+
+/*
+ * Adds the number of streams a frame's stream opener has open, flagging
+ * streams opened over the peer's limit.
+ */
+static void spdy_add_concurrency(packet_info *pinfo,
+                                 proto_tree *tree,
+                                 tvbuff_t *tvb,
+                                 const spdy_frame_info_t *frame_info) {
+  proto_item *ti;
+
+  if (frame_info == NULL || !frame_info->has_concurrency) {
+    return;
+  }
+  ti = proto_tree_add_uint(tree, hf_spdy_concurrent_streams, tvb, 0, 0,
+                           frame_info->concurrent_streams);
+  PROTO_ITEM_SET_GENERATED(ti);
+  if (!frame_info->has_concurrency_limit) {
+    return;
+  }
+  ti = proto_tree_add_uint(tree, hf_spdy_concurrency_limit, tvb, 0, 0,
+                           frame_info->concurrency_limit);
+  PROTO_ITEM_SET_GENERATED(ti);
+  if (frame_info->concurrent_streams > frame_info->concurrency_limit) {
+    expert_add_info_format(pinfo, ti, PI_SEQUENCE, PI_WARN,
+                           "Stream opened over the peer's limit of %u "
+                           "concurrent streams (%u open)",
+                           frame_info->concurrency_limit,
+                           frame_info->concurrent_streams);
+  }
+}
+
+/*
+ * Discards all state on a stream that was reset or has finished.
+ */
+static void spdy_discard_stream(spdy_conv_t *conv_data, guint32 stream_id) {
+  spdy_stream_info_t *si = spdy_get_stream_info(conv_data, stream_id);
+
+  if (si != NULL) {
+    spdy_count_stream_closed(NULL, NULL, conv_data, si, 0, 0, NULL);
+  }
+  if (g_hash_table_remove(conv_data->streams, GUINT_TO_POINTER(stream_id)) &&
+      spdy_debug) {
+    printf("Discarded stream info for ID %u\n", stream_id);
+  }
+}
+
+/* What spdy_stream_id_above() is given to go on. */
+typedef struct _spdy_goaway_t {
+  spdy_conv_t *conv_data;
+  guint32 last_good_stream_id;
+} spdy_goaway_t;
+
+static gboolean spdy_stream_id_above(gpointer key,
+                                     gpointer value,
+                                     gpointer user_data) {
+  const spdy_goaway_t *goaway = user_data;
+
+  if (GPOINTER_TO_UINT(key) <= goaway->last_good_stream_id) {
+    return FALSE;
+  }
+  spdy_count_stream_closed(NULL, NULL, goaway->conv_data, value, 0, 0, NULL);
+  return TRUE;
+}
+
+/*
+ * Discards all state on streams which a GOAWAY frame disowned, i.e. those
+ * newer than the last good stream ID.
+ */
+static void spdy_discard_streams_above(spdy_conv_t *conv_data,
+                                       guint32 last_good_stream_id) {
+  spdy_goaway_t goaway;
+
+  goaway.conv_data = conv_data;
+  goaway.last_good_stream_id = last_good_stream_id;
+  g_hash_table_foreach_remove(conv_data->streams, spdy_stream_id_above,
+                              &goaway);
+}
+
+/*
+ * Tells the two sides of a TCP connection apart, whether or not it's known
+ * which one is the client. Returns 0 or 1.
+ */
+static int spdy_segment_side(const packet_info *pinfo) {
+  int cmp = CMP_ADDRESS(&pinfo->src, &pinfo->dst);
+
+  if (cmp == 0) {
+    return pinfo->srcport < pinfo->destport ? 0 : 1;
+  }
+  return cmp < 0 ? 0 : 1;
+}
+
+/*
+ * Returns what's left of a DATA frame that a segment starts with, if it
+ * starts with one. On the first pass this is worked out from the
+ * conversation, and saved for later passes.
+ */
+static const spdy_partial_data_t* spdy_get_data_continuation(
+    tvbuff_t *tvb,
+    packet_info *pinfo,
+    spdy_conv_t *conv_data) {
+  spdy_data_continuation_t *cont;
+  spdy_frame_key_t key;
+
+  spdy_frame_key_init(&key, tvb, pinfo, 0);
+  if (!pinfo->fd->flags.visited) {
+    spdy_partial_data_t *partial =
+        &conv_data->partial_data[spdy_segment_side(pinfo)];
+
+    if (partial->remaining == 0) {
+      return NULL;
+    }
+    cont = se_alloc(sizeof(spdy_data_continuation_t));
+    cont->key = key;
+    cont->frame = *partial;
+    g_hash_table_insert(spdy_data_continuations, &cont->key, cont);
+  } else {
+    cont = g_hash_table_lookup(spdy_data_continuations, &key);
+    if (cont == NULL) {
+      return NULL;
+    }
+  }
+  return &cont->frame;
+}
+
+/*
+ * Works out, on the first pass, which milestones in the life of its stream
+ * a frame marks, and keeps them with the frame along with the time since
+ * the SYN_STREAM. Returns whether the stream is now finished in both
+ * directions.
+ */
+static gboolean spdy_note_stream_milestones(
+    tvbuff_t *tvb,
+    packet_info *pinfo,
+    spdy_conv_t *conv_data,
+    spdy_stream_info_t *si,
+    int offset,
+    const spdy_control_frame_info_t *frame,
+    spdy_frame_info_t **frame_info) {
+  spdy_stream_common_t *common = &si->common;
+  gboolean from_opener =
+      conv_data->direction == common->opener_direction;
+  gboolean fin = (frame->flags & SPDY_FLAG_FIN) != 0;
+  gboolean was_closed = common->opener_fin &&
+      (common->peer_fin || common->unidirectional);
+  gboolean closed;
+  guint8 milestones = 0;
+
+  if (frame->type == SPDY_SYN_REPLY && !common->reply_seen) {
+    common->reply_seen = TRUE;
+    milestones |= SPDY_MILESTONE_REPLY;
+  }
+  /* The first byte is the first of the response, or of the pushed body. */
+  if (frame->type == SPDY_DATA && frame->length != 0 &&
+      !common->first_byte_seen && from_opener == common->unidirectional) {
+    common->first_byte_seen = TRUE;
+    milestones |= SPDY_MILESTONE_FIRST_BYTE;
+  }
+  if (fin) {
+    if (from_opener) {
+      common->opener_fin = TRUE;
+    } else {
+      common->peer_fin = TRUE;
+    }
+  }
+  closed = common->opener_fin && (common->peer_fin || common->unidirectional);
+  if (closed && !was_closed) {
+    milestones |= SPDY_MILESTONE_CLOSED;
+    spdy_count_stream_closed(tvb, pinfo, conv_data, si, offset, frame->type,
+                             frame_info);
+    spdy_end_push(tvb, pinfo, conv_data, si, offset, frame->type,
+                  SPDY_PUSH_COMPLETED, 0, frame_info);
+  }
+
+  if (milestones != 0 && common->syn_stream_frame != 0) {
+    if (*frame_info == NULL) {
+      *frame_info = spdy_add_frame_info(tvb, pinfo, offset, si->stream_id,
+                                        frame->type);
+    }
+    (*frame_info)->milestones = milestones;
+    (*frame_info)->syn_stream_frame = common->syn_stream_frame;
+    nstime_delta(&(*frame_info)->time_since_syn_stream,
+                 &pinfo->fd->abs_ts, &common->syn_stream_time);
+  }
+  return closed;
+}
+
+/*
+ * Charges a DATA frame against its sender's send windows, on the first pass.
+ */
+static void spdy_track_data_window(tvbuff_t *tvb,
+                                   packet_info *pinfo,
+                                   spdy_conv_t *conv_data,
+                                   spdy_stream_info_t *si,
+                                   int offset,
+                                   const spdy_control_frame_info_t *frame,
+                                   spdy_frame_info_t **frame_info) {
+  spdy_direction_t direction = conv_data->direction;
+  int idx;
+
+  if (direction == SPDY_DIRECTION_UNKNOWN || si->common.syn_stream_frame == 0) {
+    return;
+  }
+  idx = direction - 1;
+  si->common.send_window[idx] -= frame->length;
+  if (*frame_info == NULL) {
+    *frame_info = spdy_add_frame_info(tvb, pinfo, offset, si->stream_id,
+                                      SPDY_DATA);
+  }
+  (*frame_info)->has_window = TRUE;
+  (*frame_info)->window = (gint32)si->common.send_window[idx];
+  if (conv_data->conn_flow_control) {
+    conv_data->conn_window[idx] -= frame->length;
+    (*frame_info)->has_conn_window = TRUE;
+    (*frame_info)->conn_window = (gint32)conv_data->conn_window[idx];
+  }
+}
+
+/*
+ * Adds the send windows a frame leaves, flagging DATA frames that use up
+ * a window.
+ */
+static void spdy_add_windows(packet_info *pinfo,
+                             proto_tree *tree,
+                             tvbuff_t *tvb,
+                             spdy_frame_info_t *frame_info) {
+  proto_item *ti;
+
+  if (frame_info == NULL) {
+    return;
+  }
+  if (frame_info->has_window) {
+    ti = proto_tree_add_int(tree, hf_spdy_window, tvb, 0, 0,
+                            frame_info->window);
+    PROTO_ITEM_SET_GENERATED(ti);
+  }
+  if (frame_info->has_conn_window) {
+    ti = proto_tree_add_int(tree, hf_spdy_conn_window, tvb, 0, 0,
+                            frame_info->conn_window);
+    PROTO_ITEM_SET_GENERATED(ti);
+  }
+  if (frame_info->frame_type != SPDY_DATA) {
+    return;
+  }
+  if ((frame_info->has_window && frame_info->window < 0) ||
+      (frame_info->has_conn_window && frame_info->conn_window < 0)) {
+    expert_add_info_format(pinfo, tree, PI_PROTOCOL, PI_WARN,
+                           "DATA frame exceeds the sender's flow control "
+                           "window");
+  } else if ((frame_info->has_window && frame_info->window == 0) ||
+             (frame_info->has_conn_window && frame_info->conn_window == 0)) {
+    expert_add_info_format(pinfo, tree, PI_SEQUENCE, PI_WARN,
+                           "Flow control window exhausted: the sender is "
+                           "stalled until it gets a WINDOW_UPDATE");
+  }
+}
+
+/*
+ * DATA payload bytes sent in a direction, on the first pass, by streams of
+ * lower priority than the given one.
+ */
+static guint64 spdy_lower_priority_bytes(const spdy_conv_t *conv_data,
+                                         int idx,
+                                         guint8 priority) {
+  guint64 bytes = 0;
+  guint p;
+
+  for (p = priority + 1; p < SPDY_NUM_PRIORITIES; p++) {
+    bytes += conv_data->data_bytes_by_priority[idx][p];
+  }
+  return bytes;
+}
+
+/*
+ * Notes, on the first pass, that a stream may now send data in the
+ * direction of the current segment: its opener once the SYN_STREAM is
+ * sent, the other side once the SYN_REPLY is.
+ */
+static void spdy_start_sending(spdy_conv_t *conv_data,
+                               spdy_stream_info_t *si) {
+  int idx;
+
+  if (conv_data->direction == SPDY_DIRECTION_UNKNOWN ||
+      !si->common.priority_known) {
+    return;
+  }
+  idx = conv_data->direction - 1;
+  si->common.sending[idx] = TRUE;
+  si->common.lower_priority_mark[idx] =
+      spdy_lower_priority_bytes(conv_data, idx, si->common.priority);
+}
+
+/*
+ * Checks a DATA frame, on the first pass, for priority inversion: any
+ * lower-priority DATA sent the same way since its stream last sent, or
+ * since it could first send, went out ahead of it. The sender's queue
+ * can't be seen, so a stream is taken to have data pending from then
+ * until it sends its FIN.
+ */
+static void spdy_track_data_priority(tvbuff_t *tvb,
+                                     packet_info *pinfo,
+                                     spdy_conv_t *conv_data,
+                                     spdy_stream_info_t *si,
+                                     int offset,
+                                     const spdy_control_frame_info_t *frame,
+                                     spdy_frame_info_t **frame_info) {
+  spdy_stream_common_t *common = &si->common;
+  guint64 ahead = 0;
+  int idx;
+
+  if (conv_data->direction == SPDY_DIRECTION_UNKNOWN ||
+      !common->priority_known) {
+    return;
+  }
+  idx = conv_data->direction - 1;
+  if (common->sending[idx] && frame->length != 0) {
+    ahead = spdy_lower_priority_bytes(conv_data, idx, common->priority) -
+        common->lower_priority_mark[idx];
+    if (ahead != 0) {
+      conv_data->priority_inversions++;
+      conv_data->bytes_ahead += ahead;
+    }
+  }
+  conv_data->data_bytes_by_priority[idx][common->priority] += frame->length;
+  if ((frame->flags & SPDY_FLAG_FIN) != 0) {
+    common->sending[idx] = FALSE;
+  } else {
+    spdy_start_sending(conv_data, si);
+  }
+
+  if (*frame_info == NULL) {
+    *frame_info = spdy_add_frame_info(tvb, pinfo, offset, si->stream_id,
+                                      SPDY_DATA);
+  }
+  (*frame_info)->has_priority = TRUE;
+  (*frame_info)->priority = common->priority;
+  (*frame_info)->bytes_ahead = (guint32)MIN(ahead, G_MAXUINT32);
+  (*frame_info)->conv_priority_inversions = conv_data->priority_inversions;
+  (*frame_info)->conv_bytes_ahead = conv_data->bytes_ahead;
+}
+
+/*
+ * Adds the priority of a DATA frame's stream and the connection's priority
+ * inversions so far, flagging frames that lower-priority DATA went ahead of.
+ */
+static void spdy_add_priority_inversion(packet_info *pinfo,
+                                        proto_tree *tree,
+                                        tvbuff_t *tvb,
+                                        spdy_frame_info_t *frame_info) {
+  proto_item *ti;
+
+  if (frame_info == NULL || !frame_info->has_priority) {
+    return;
+  }
+  ti = proto_tree_add_uint(tree, hf_spdy_priority, tvb, 0, 0,
+                           frame_info->priority);
+  PROTO_ITEM_SET_GENERATED(ti);
+  if (frame_info->bytes_ahead != 0) {
+    ti = proto_tree_add_uint(tree, hf_spdy_bytes_ahead, tvb, 0, 0,
+                             frame_info->bytes_ahead);
+    PROTO_ITEM_SET_GENERATED(ti);
+    expert_add_info_format(pinfo, ti, PI_SEQUENCE, PI_NOTE,
+                           "Priority inversion: %u bytes of lower-priority "
+                           "DATA sent while stream %u (priority %u) had "
+                           "data pending",
+                           frame_info->bytes_ahead, frame_info->stream_id,
+                           frame_info->priority);
+  }
+  ti = proto_tree_add_uint(tree, hf_spdy_conv_priority_inversions, tvb, 0, 0,
+                           frame_info->conv_priority_inversions);
+  PROTO_ITEM_SET_GENERATED(ti);
+  ti = proto_tree_add_uint64(tree, hf_spdy_conv_bytes_ahead, tvb, 0, 0,
+                             frame_info->conv_bytes_ahead);
+  PROTO_ITEM_SET_GENERATED(ti);
+}
+
+/*
+ * Adds the timing of the stream milestones a frame marks, if any.
+ */
+static void spdy_add_stream_timing(proto_tree *tree,
+                                   tvbuff_t *tvb,
+                                   spdy_frame_info_t *frame_info) {
+  proto_item *ti;
+
+  if (tree == NULL || frame_info == NULL || frame_info->milestones == 0) {
+    return;
+  }
+  ti = proto_tree_add_uint(tree, hf_spdy_syn_stream_in, tvb, 0, 0,
+                           frame_info->syn_stream_frame);
+  PROTO_ITEM_SET_GENERATED(ti);
+  if (frame_info->milestones & SPDY_MILESTONE_REPLY) {
+    ti = proto_tree_add_time(tree, hf_spdy_time_to_reply, tvb, 0, 0,
+                             &frame_info->time_since_syn_stream);
+    PROTO_ITEM_SET_GENERATED(ti);
+  }
+  if (frame_info->milestones & SPDY_MILESTONE_FIRST_BYTE) {
+    ti = proto_tree_add_time(tree, hf_spdy_time_to_first_byte, tvb, 0, 0,
+                             &frame_info->time_since_syn_stream);
+    PROTO_ITEM_SET_GENERATED(ti);
+  }
+  if (frame_info->milestones & SPDY_MILESTONE_CLOSED) {
+    ti = proto_tree_add_time(tree, hf_spdy_stream_duration, tvb, 0, 0,
+                             &frame_info->time_since_syn_stream);
+    PROTO_ITEM_SET_GENERATED(ti);
+  }
+}
+
+/*
+ * Whether entity bodies with a given content encoding are encoded in a
+ * way that we can inflate as they arrive.
+ */
+static gboolean spdy_body_is_deflated(const gchar *content_encoding) {
+  return spdy_decompress_body && content_encoding != NULL &&
+      (g_ascii_strcasecmp(content_encoding, "gzip") == 0 ||
+       g_ascii_strcasecmp(content_encoding, "deflate") == 0);
+}
+
+/*
+ * Inflates one chunk of a content-encoded entity body, appending at most
+ * max_length bytes of decoded output in total to its body data.
+ */
+static void spdy_inflate_data_chunk(spdy_body_sender_t *body,
+                                    GByteArray *out,
+                                    const guint8 *data,
+                                    guint32 length,
+                                    guint max_length) {
+  static guint8 outbuf[SPDY_BODY_INFLATE_CHUNK_SIZE];
+  z_streamp decomp;
+  gboolean first_chunk = (body->encoded_length == 0);
+  int retcode;
+
+  if (body->body_decode_failed) {
+    return;
+  }
+  if (!body->body_decoded) {
+    /* Accept both zlib and gzip headers. */
+    body->body_decompressor = g_malloc0(sizeof(z_stream));
+    if (inflateInit2(body->body_decompressor, MAX_WBITS + 32) != Z_OK) {
+      g_free(body->body_decompressor);
+      body->body_decompressor = NULL;
+      body->body_decode_failed = TRUE;
+      return;
+    }
+    body->body_decoded = TRUE;
+  }
+  body->encoded_length += length;
+  if (body->body_decompressor == NULL) {
+    /* We've already seen the end of the compressed body. */
+    return;
+  }
 
-    conv_data->streams = NULL;
-    if (spdy_decompress_headers) {
-      conv_data->rqst_decompressor = se_alloc0(sizeof(z_stream));
-      conv_data->rply_decompressor = se_alloc0(sizeof(z_stream));
-      retcode = inflateInit(conv_data->rqst_decompressor);
-      if (retcode == Z_OK) {
-        retcode = inflateInit(conv_data->rply_decompressor);
-      }
-      if (retcode != Z_OK) {
-        printf("frame #%d: inflateInit() failed: %d\n",
-               pinfo->fd->num, retcode);
+  decomp = body->body_decompressor;
+  decomp->next_in = (Bytef *)data;
+  decomp->avail_in = length;
+  do {
+    guint produced;
+
+    decomp->next_out = outbuf;
+    decomp->avail_out = sizeof(outbuf);
+    retcode = spdy_counted_inflate(decomp, Z_SYNC_FLUSH,
+                                   &spdy_perf.body_inflate);
+    if (retcode == Z_DATA_ERROR && first_chunk && body->decoded_length == 0) {
+      /*
+       * Some servers send "deflate" bodies without the zlib header;
+       * start over on this chunk as a raw deflate stream.
+       */
+      first_chunk = FALSE;
+      inflateEnd(decomp);
+      memset(decomp, 0, sizeof(z_stream));
+      if (inflateInit2(decomp, -MAX_WBITS) != Z_OK) {
+        /* There's no inflater left to end. */
+        g_free(decomp);
+        body->body_decompressor = NULL;
+        body->body_decode_failed = TRUE;
+        return;
       }
-      conv_data->dictionary_id = adler32(0L, Z_NULL, 0);
-      conv_data->dictionary_id = adler32(conv_data->dictionary_id,
-                                         spdy_dictionary,
-                                         sizeof(spdy_dictionary));
+      decomp->next_in = (Bytef *)data;
+      decomp->avail_in = length;
+      retcode = Z_OK;
+      continue;
+    }
+    produced = sizeof(outbuf) - decomp->avail_out;
+    body->decoded_length += produced;
+    if (out->len < max_length) {
+      g_byte_array_append(out, outbuf, MIN(produced, max_length - out->len));
+    }
+    if (retcode == Z_BUF_ERROR && decomp->avail_in == 0) {
+      /* Nothing more to be had from what we've seen of the body. */
+      retcode = Z_OK;
+      break;
     }
+  } while (retcode == Z_OK &&
+           (decomp->avail_in != 0 || decomp->avail_out == 0));
 
-    conversation_add_proto_data(conversation, proto_spdy, conv_data);
-    register_postseq_cleanup_routine(reset_decompressors);
+  if (retcode == Z_STREAM_END) {
+    spdy_end_body_decompressor(body);
+  } else if (retcode != Z_OK) {
+    if (spdy_debug) {
+      printf("Body inflation failed after %u bytes: %d\n",
+             body->decoded_length, retcode);
+    }
+    spdy_end_body_decompressor(body);
+    body->body_decode_failed = TRUE;
   }
-
-  return conv_data;
 }
 
 /*
- * Retains state on a given stream.
+ * Whether a media type is in a comma-separated list of them.
  */
-static void spdy_save_stream_info(spdy_conv_t *conv_data,
-                                  guint32 stream_id,
-                                  gchar *content_type,
-                                  gchar *content_type_params,
-                                  gchar *content_encoding) {
-  spdy_stream_info_t *si;
+static gboolean spdy_media_type_listed(const char *list,
+                                       const gchar *media_type) {
+  gchar **types;
+  gboolean listed = FALSE;
+  guint i;
 
-  if (conv_data->streams == NULL) {
-    conv_data->streams = g_array_new(FALSE, TRUE, sizeof(spdy_stream_info_t *));
+  if (list == NULL || list[0] == '\0' || media_type == NULL) {
+    return FALSE;
   }
-  if (stream_id < conv_data->streams->len) {
-    DISSECTOR_ASSERT(g_array_index(conv_data->streams, spdy_stream_info_t*, stream_id) == NULL);
-  } else {
-    g_array_set_size(conv_data->streams, stream_id+1);
-  }
-  si = se_alloc(sizeof(spdy_stream_info_t));
-  si->content_type = content_type;
-  si->content_type_parameters = content_type_params;
-  si->content_encoding = content_encoding;
-  si->data_frames = NULL;
-  si->num_data_frames = 0;
-  si->assembled_data = NULL;
-  g_array_index(conv_data->streams, spdy_stream_info_t*, stream_id) = si;
+  types = g_strsplit(list, ",", -1);
+  for (i = 0; types[i] != NULL && !listed; i++) {
+    gchar *type = g_strstrip(types[i]);
+    gsize len = strlen(type);
+
+    if (len >= 2 && type[len - 2] == '/' && type[len - 1] == '*') {
+      listed = g_ascii_strncasecmp(media_type, type, len - 1) == 0;
+    } else {
+      listed = g_ascii_strcasecmp(media_type, type) == 0;
+    }
+  }
+  g_strfreev(types);
+  return listed;
+}
+
+/*
+ * Whether bodies of a given media type, or with none if it is NULL, are
+ * to be reassembled and decoded.
+ */
+static gboolean spdy_body_type_wanted(const gchar *media_type) {
+  if (spdy_media_type_listed(spdy_body_unwanted_types, media_type)) {
+    return FALSE;
+  }
+  return spdy_body_wanted_types == NULL ||
+      spdy_body_wanted_types[0] == '\0' ||
+      spdy_media_type_listed(spdy_body_wanted_types, media_type);
+}
+
+/*
+ * Stops keeping the entity body one side of a stream sends; from then on,
+ * its DATA frames are only counted.
+ */
+static void spdy_skip_body(spdy_stream_info_t *si, int side, guint8 reason) {
   if (spdy_debug) {
-    printf("Saved stream info for ID %u, content type %s\n",
-           stream_id, content_type);
+    printf("Not keeping the body of stream %u (%s)\n", si->stream_id,
+           reason == SPDY_BODY_SKIPPED_TYPE ? "content type" : "size");
+  }
+  si->sender[side].skipped = reason;
+  spdy_release_body(&si->sender[side]);
+  if (si->sender[side].spool_path != NULL) {
+    /* The path itself stays on the list of those to clean up. */
+    ws_unlink(si->sender[side].spool_path);
   }
 }
 
 /*
- * Retrieves previously saved state on a given stream.
+ * Checks a DATA chunk against the body decoding preferences for the side
+ * sending it, on the first pass, before the chunk is added to its stream.
+ * Sides whose content type is known were checked for it when it was seen.
  */
-static spdy_stream_info_t* spdy_get_stream_info(spdy_conv_t *conv_data,
-                                                guint32 stream_id) {
-    if (conv_data->streams == NULL || stream_id >= conv_data->streams->len) {
-      return NULL;
-    } else {
-      return g_array_index(conv_data->streams, spdy_stream_info_t*, stream_id);
+static void spdy_check_body_policy(spdy_stream_info_t *si,
+                                   int side,
+                                   guint32 length) {
+  spdy_body_sender_t *sender = &si->sender[side];
+
+  if (sender->skipped != SPDY_BODY_KEPT) {
+    return;
+  }
+  if (!sender->policy_checked) {
+    sender->policy_checked = TRUE;
+    if (!spdy_body_type_wanted(sender->content_type)) {
+      spdy_skip_body(si, side, SPDY_BODY_SKIPPED_TYPE);
+      return;
     }
+  }
+  sender->bytes_seen += length;
+  if (spdy_max_body_size != 0 &&
+      sender->bytes_seen > (guint64)spdy_max_body_size * 1024) {
+    spdy_skip_body(si, side, SPDY_BODY_SKIPPED_SIZE);
+  }
 }
 
 /*
- * Adds a data chunk to a given SPDY converstaion/stream.
+ * Adds a data chunk to a given SPDY stream.
+ *
+ * Content-encoded chunks are inflated right away and only the decoded output
+ * is kept. Other chunks are kept only if bodies are being reassembled.
  */
-static void spdy_add_data_chunk(spdy_conv_t *conv_data,
+static void spdy_add_data_chunk(spdy_stream_info_t *si,
+                                int side,
                                 guint32 stream_id,
                                 guint32 frame,
-                                guint8 *data,
+                                tvbuff_t *tvb,
+                                int offset,
                                 guint32 length) {
-  spdy_stream_info_t *si = spdy_get_stream_info(conv_data, stream_id);
-
   if (si == NULL) {
     if (spdy_debug) {
       printf("No stream_info found for stream %d\n", stream_id);
     }
   } else {
-    spdy_data_frame_t *df = g_malloc(sizeof(spdy_data_frame_t));
-    df->data = data;
-    df->length = length;
-    df->framenum = frame;
-    si->data_frames = g_slist_append(si->data_frames, df);
-    ++si->num_data_frames;
+    spdy_body_sender_t *sender = &si->sender[side];
+    spdy_body_t *body;
+
+    ++sender->num_data_frames;
+    if (spdy_body_evicted(sender) || sender->skipped != SPDY_BODY_KEPT ||
+        (!spdy_body_is_deflated(sender->content_encoding) &&
+         !spdy_assemble_entity_bodies)) {
+      /* Over the memory limit, or not wanted; keep count only. */
+      return;
+    }
+    body = spdy_get_sender_body(sender);
+    if (spdy_body_is_deflated(sender->content_encoding)) {
+      spdy_inflate_data_chunk(sender,
+                              body->data,
+                              tvb_get_ptr(tvb, offset, length),
+                              length,
+                              spdy_assemble_entity_bodies ?
+                                G_MAXUINT : SPDY_BODY_DECODED_PREFIX_SIZE);
+    } else {
+      g_byte_array_append(body->data, tvb_get_ptr(tvb, offset, length), length);
+    }
+    if (spdy_assemble_entity_bodies && !spdy_spool_body_data(sender, body)) {
+      return;
+    }
+    spdy_set_retained_bytes(body, body->data->len);
+
+    if (sender->frames == NULL) {
+      sender->frames = g_array_new(FALSE, FALSE, sizeof(guint32));
+    }
+    if (sender->frames->len == 0 ||
+        g_array_index(sender->frames, guint32, sender->frames->len - 1) !=
+          frame) {
+      g_array_append_val(sender->frames, frame);
+    }
     if (spdy_debug) {
       printf("Saved %u bytes of data for stream %u frame %u\n",
-             length, stream_id, df->framenum);
+             length, stream_id, frame);
     }
   }
 }
 
 /*
- * Increment the count of DATA frames found on a given stream.
- */
-static void spdy_increment_data_chunk_count(spdy_conv_t *conv_data,
-                                            guint32 stream_id) {
-  spdy_stream_info_t *si = spdy_get_stream_info(conv_data, stream_id);
-  if (si != NULL) {
-    ++si->num_data_frames;
-  }
-}
-
-/*
- * Return the number of data frames saved so far for the specified stream.
+ * Returns the record kept of the entity body one side of a stream sends,
+ * making it on the first call.
  */
-static guint spdy_get_num_data_frames(spdy_conv_t *conv_data,
-                                      guint32 stream_id) {
-  spdy_stream_info_t *si = spdy_get_stream_info(conv_data, stream_id);
+static spdy_entity_body_t* spdy_get_entity_body(spdy_stream_info_t *si,
+                                                int side) {
+  spdy_body_sender_t *sender = &si->sender[side];
 
-  return si == NULL ? 0 : si->num_data_frames;
+  if (sender->entity == NULL) {
+    sender->entity = se_alloc0(sizeof(spdy_entity_body_t));
+    sender->entity->stream_id = si->stream_id;
+  }
+  sender->entity->body_id = sender->body_id;
+  return sender->entity;
 }
 
 /*
- * Reassembles DATA frames for a given stream into one tvb.
+ * Finishes the entity body one side of a stream sends, on seeing its last
+ * DATA frame: reassembles its DATA frames into one tvb, or finishes its
+ * spool file, keeps what its frames need to be shown again, and releases
+ * everything else. Returns the record kept of it.
  */
-static spdy_stream_info_t* spdy_assemble_data_frames(spdy_conv_t *conv_data,
-                                                     guint32 stream_id) {
-  spdy_stream_info_t *si = spdy_get_stream_info(conv_data, stream_id);
-  tvbuff_t *tvb;
-
-  if (si == NULL) {
-    return NULL;
+static spdy_entity_body_t* spdy_finish_body(spdy_stream_info_t *si,
+                                            int side) {
+  spdy_body_sender_t *sender = &si->sender[side];
+  spdy_entity_body_t *entity;
+  spdy_body_t *body = NULL;
+  guint32 body_id = 0;
+  const gchar *content_type;
+  const gchar *content_type_parameters;
+  const gchar *content_encoding;
+
+  spdy_end_body_decompressor(sender);
+  if (!spdy_body_evicted(sender)) {
+    body = spdy_get_body(sender->body_id);
   }
-
-  /*
-   * Compute the total amount of data and concatenate the
-   * data chunks, if it hasn't already been done.
-   */
-  if (si->assembled_data == NULL) {
-    spdy_data_frame_t *df;
-    guint8 *data;
-    guint32 datalen;
-    guint32 offset;
-    guint32 framenum;
-    GSList *dflist = si->data_frames;
-    if (dflist == NULL) {
-      return si;
+  if (sender->spool != NULL) {
+    /*
+     * A spooled body just needs the rest of it written out; if that
+     * fails, the spool file has been dealt with already.
+     */
+    if (body == NULL || spdy_spool_body_data(sender, body)) {
+      if (fclose(sender->spool) != 0) {
+        sender->spool_failed = TRUE;
+        sender->body_evicted = TRUE;
+      }
+      sender->spool = NULL;
     }
-    datalen = 0;
+  } else if (body != NULL && body->data->len != 0) {
     /*
+     * Hand the concatenated data chunks over to a tvb. The tvb takes
+     * ownership of the buffer, so the payloads are copied only once, when
+     * each DATA frame is seen.
+     *
      * It'd be nice to use a composite tvbuff here, but since
      * only a real-data tvbuff can be the child of another
      * tvb, we can't. It would be nice if this limitation
      * could be fixed.
      */
-    while (dflist != NULL) {
-      df = dflist->data;
-      datalen += df->length;
-      dflist = g_slist_next(dflist);
-    }
-    if (datalen != 0) {
-      data = se_alloc(datalen);
-      dflist = si->data_frames;
-      offset = 0;
-      framenum = 0;
-      while (dflist != NULL) {
-        df = dflist->data;
-        memcpy(data+offset, df->data, df->length);
-        offset += df->length;
-        dflist = g_slist_next(dflist);
-      }
-      tvb = tvb_new_real_data(data, datalen, datalen);
-      si->assembled_data = tvb;
-    }
+    guint32 datalen = body->data->len;
+    guint8 *data = g_byte_array_free(body->data, FALSE);
+
+    body->data = NULL;
+    body->assembled_data = tvb_new_real_data(data, datalen, datalen);
+    tvb_set_free_cb(body->assembled_data, g_free);
+    /* The body stays, and stays up for eviction, after its stream is gone. */
+    body_id = body->id;
+    sender->body_id = 0;
   }
-  return si;
+
+  entity = spdy_get_entity_body(si, side);
+  entity->body_id = body_id;
+  entity->host = si->common.host;
+  entity->path = si->common.path;
+  entity->content_type = sender->content_type;
+  entity->content_type_parameters = sender->content_type_parameters;
+  entity->content_encoding = sender->content_encoding;
+  entity->skipped = sender->skipped;
+  entity->bytes_seen = sender->bytes_seen;
+  entity->num_data_frames = sender->num_data_frames;
+  if (sender->frames != NULL) {
+    entity->num_frames = sender->frames->len;
+    entity->frames = se_memdup(sender->frames->data,
+                               sender->frames->len * sizeof(guint32));
+  }
+  entity->body_decoded = sender->body_decoded;
+  entity->body_decode_failed = sender->body_decode_failed;
+  entity->encoded_length = sender->encoded_length;
+  entity->decoded_length = sender->decoded_length;
+  entity->body_evicted = sender->body_evicted;
+  entity->spool_failed = sender->spool_failed;
+  entity->spool_path = sender->spool_path;
+  entity->spooled_length = sender->spooled_length;
+
+  /*
+   * Start that side over, in case it sends more; only what its headers
+   * said of the body carries over.
+   */
+  spdy_release_body(sender);
+  content_type = sender->content_type;
+  content_type_parameters = sender->content_type_parameters;
+  content_encoding = sender->content_encoding;
+  memset(sender, 0, sizeof(*sender));
+  sender->stream_id = si->stream_id;
+  sender->content_type = content_type;
+  sender->content_type_parameters = content_type_parameters;
+  sender->content_encoding = content_encoding;
+  return entity;
 }
 
 /*
- * Cleans up data frames accounted for by a given stream.
+ * Returns a copy of a given tvb that is freed along with parent.
  */
-static void spdy_discard_data_frames(spdy_stream_info_t *si) {
-  GSList *dflist = si->data_frames;
-  spdy_data_frame_t *df;
-
-  if (dflist == NULL) {
-    return;
-  }
-  while (dflist != NULL) {
-    df = dflist->data;
-    if (df->data != NULL) {
-      g_free(df->data);
-      df->data = NULL;
-    }
-    dflist = g_slist_next(dflist);
-  }
-  /*
-  TODO(hkhalil): Why was this commented out?
-  g_slist_free(si->data_frames);
-  si->data_frames = NULL;
-  */
+static tvbuff_t* spdy_tvb_child_copy(tvbuff_t *parent, tvbuff_t *tvb) {
+  guint len = tvb_length(tvb);
+  tvbuff_t *copy_tvb = tvb_new_child_real_data(parent,
+                                               tvb_memdup(tvb, 0, len),
+                                               len, len);
+
+  tvb_set_free_cb(copy_tvb, g_free);
+  return copy_tvb;
 }
 
 /* TODO(cbentzel): tvb_child_uncompress should be exported by wireshark. */
@@ -675,6 +2770,15 @@ static tvbuff_t* spdy_tvb_child_uncompress(tvbuff_t *parent _U_, tvbuff_t *tvb,
   return new_tvb;
 }
 
+/*
+ * Whether the Info column will be shown for this packet. When it won't be,
+ * and there's no tree to fill in either, dissection is only done for the
+ * state that later frames depend on, and all text formatting is skipped.
+ */
+static gboolean spdy_info_wanted(packet_info *pinfo) {
+  return check_col(pinfo->cinfo, COL_INFO) ? TRUE : FALSE;
+}
+
 /*
  * Adds control bit details to proto tree.
  */
@@ -705,7 +2809,7 @@ static void dissect_spdy_stream_id_field(tvbuff_t *tvb,
                                          const int hfindex) {
   guint32 stream_id = get_spdy_stream_id(tvb, offset);
   /* Add stream id to info column. */
-  if (hfindex == hf_spdy_streamid) {
+  if (hfindex == hf_spdy_streamid && spdy_info_wanted(pinfo)) {
     col_append_fstr(pinfo->cinfo, COL_INFO, " Stream=%u", stream_id);
   }
 
@@ -802,6 +2906,49 @@ static void dissect_spdy_flags(tvbuff_t *tvb,
   }
 }
 
+/*
+ * Hands a complete entity body to the export objects tap; body_tvb is NULL
+ * if the body was spooled.
+ */
+static void spdy_queue_export_object(packet_info *pinfo,
+                                     const spdy_entity_body_t *entity,
+                                     tvbuff_t *body_tvb) {
+  spdy_eo_t *eo_info;
+
+  if (!have_tap_listener(spdy_eo_tap)) {
+    return;
+  }
+  eo_info = ep_alloc0(sizeof(spdy_eo_t));
+  eo_info->pkt_num = pinfo->fd->num;
+  eo_info->hostname = entity->host;
+  eo_info->filename = entity->path;
+  eo_info->content_type = entity->content_type;
+  if (body_tvb != NULL) {
+    eo_info->payload_len = tvb_length(body_tvb);
+    eo_info->payload_data = tvb_get_ptr(body_tvb, 0, eo_info->payload_len);
+  } else {
+    eo_info->payload_len = entity->spooled_length;
+    eo_info->spool_path = entity->spool_path;
+  }
+  tap_queue_packet(spdy_eo_tap, pinfo, eo_info);
+}
+
+/*
+ * Looks up the media type subdissector for an interned media type, going
+ * to the dissector table only the first time the media type is seen.
+ */
+static dissector_handle_t spdy_get_media_handle(const gchar *media_type) {
+  gpointer handle;
+
+  if (!g_hash_table_lookup_extended(spdy_media_handles, media_type,
+                                    NULL, &handle)) {
+    handle = dissector_get_string_handle(media_type_subdissector_table,
+                                         media_type);
+    g_hash_table_insert(spdy_media_handles, (gpointer)media_type, handle);
+  }
+  return handle;
+}
+
 /*
  * Performs DATA frame payload dissection.
  */
@@ -813,62 +2960,138 @@ static int dissect_spdy_data_payload(tvbuff_t *tvb,
                                      proto_item *spdy_proto,
                                      spdy_conv_t *conv_data,
                                      guint32 stream_id,
-                                     const spdy_control_frame_info_t *frame) {
-  dissector_table_t media_type_subdissector_table;
-  dissector_table_t port_subdissector_table;
+                                     const spdy_control_frame_info_t *frame,
+                                     guint32 chunk_length,
+                                     gboolean first_chunk,
+                                     gboolean last_chunk) {
   dissector_handle_t handle;
-  guint num_data_frames;
+  spdy_stream_info_t *si = NULL;
+  spdy_body_sender_t *sender = NULL;
+  spdy_entity_body_t *entity;
+  int side = spdy_segment_side(pinfo);
+  spdy_frame_info_t *frame_info = NULL;
+  guint num_data_frames = 0;
+  gboolean stream_closed = FALSE;
   gboolean dissected;
+  spdy_control_frame_info_t chunk_frame;
 
-  col_add_fstr(pinfo->cinfo, COL_INFO, "DATA Stream=%d Length=%d",
-               stream_id, frame->length);
+  if (spdy_info_wanted(pinfo)) {
+    if (first_chunk) {
+      col_add_fstr(pinfo->cinfo, COL_INFO, "DATA Stream=%d Length=%d",
+                   stream_id, frame->length);
+    } else {
+      col_add_fstr(pinfo->cinfo, COL_INFO, "DATA Stream=%d (continued)",
+                   stream_id);
+    }
+  }
 
   if (spdy_tree) {
     /* Add frame description. */
-    proto_item_append_text(spdy_proto, ", Stream: %d, Length: %d",
-                           stream_id,
-                           frame->length);
+    if (first_chunk) {
+      proto_item_append_text(spdy_proto, ", Stream: %d, Length: %d",
+                             stream_id,
+                             frame->length);
+    }
 
     /* Add data. */
     proto_tree_add_item(spdy_tree,
                         hf_spdy_data,
                         tvb, offset,
-                        frame->length,
+                        chunk_length,
                         ENC_NA);
   }
 
-  num_data_frames = spdy_get_num_data_frames(conv_data, stream_id);
-  if (frame->length != 0 || num_data_frames != 0) {
+  /*
+   * The stream's state is only there on the first pass; it's let go of
+   * once the stream is finished. Later passes go by the frame info.
+   */
+  if (pinfo->fd->flags.visited) {
+    frame_info = spdy_get_frame_info(tvb, pinfo, offset);
+  } else {
+    si = spdy_get_stream_info(conv_data, stream_id);
+  }
+  if (si != NULL) {
+    /*
+     * A frame spread over several segments gets its first byte noted with
+     * its header, and its FIN with its last bytes.
+     */
+    chunk_frame = *frame;
+    if (!first_chunk) {
+      chunk_frame.length = 0;
+    }
+    if (!last_chunk) {
+      chunk_frame.flags &= ~SPDY_FLAG_FIN;
+    }
+    if (first_chunk) {
+      spdy_track_push_data(conv_data, si, frame);
+    }
+    stream_closed = spdy_note_stream_milestones(tvb, pinfo, conv_data, si,
+                                                offset, &chunk_frame,
+                                                &frame_info);
+    if (first_chunk) {
+      spdy_track_data_window(tvb, pinfo, conv_data, si, offset, frame,
+                             &frame_info);
+      spdy_track_data_priority(tvb, pinfo, conv_data, si, offset, frame,
+                               &frame_info);
+    }
+  }
+  spdy_add_stream_timing(spdy_tree, tvb, frame_info);
+  spdy_add_windows(pinfo, spdy_tree, tvb, frame_info);
+  spdy_add_priority_inversion(pinfo, spdy_tree, tvb, frame_info);
+  spdy_add_concurrency(pinfo, spdy_tree, tvb, frame_info);
+  spdy_add_push_info(pinfo, spdy_tree, tvb, frame_info);
+
+  if (si != NULL) {
+    sender = &si->sender[side];
+    num_data_frames = sender->num_data_frames;
+  } else if (frame_info != NULL && frame_info->body != NULL) {
+    num_data_frames = frame_info->body->num_data_frames;
+  }
+  if (chunk_length != 0 || num_data_frames != 0) {
     /*
      * There's stuff left over; process it.
      */
     tvbuff_t *next_tvb = NULL;
     tvbuff_t    *data_tvb = NULL;
-    spdy_stream_info_t *si = NULL;
     void *save_private_data = NULL;
-    guint8 *copied_data;
     gboolean private_data_changed = FALSE;
     gboolean is_single_chunk = FALSE;
     gboolean have_entire_body;
+    spdy_body_t *body;
 
     /*
      * Create a tvbuff for the payload.
      */
-    if (frame->length != 0) {
-      next_tvb = tvb_new_subset(tvb, offset, frame->length, frame->length);
-      is_single_chunk = num_data_frames == 0 &&
+    if (chunk_length != 0) {
+      next_tvb = tvb_new_subset(tvb, offset, chunk_length, chunk_length);
+      is_single_chunk = num_data_frames == 0 && first_chunk && last_chunk &&
           (frame->flags & SPDY_FLAG_FIN) != 0;
       if (!pinfo->fd->flags.visited) {
+        if (si != NULL) {
+          spdy_check_body_policy(si, side, chunk_length);
+        }
         if (!is_single_chunk) {
-          if (spdy_assemble_entity_bodies) {
-            copied_data = tvb_memdup(next_tvb, 0, frame->length);
-            spdy_add_data_chunk(conv_data,
-                                stream_id,
-                                pinfo->fd->num,
-                                copied_data,
-                                frame->length);
-          } else {
-            spdy_increment_data_chunk_count(conv_data, stream_id);
+          guint evicted;
+
+          spdy_add_data_chunk(si,
+                              side,
+                              stream_id,
+                              pinfo->fd->num,
+                              next_tvb,
+                              0,
+                              chunk_length);
+          evicted = spdy_evict_bodies();
+          if ((evicted != 0 || (sender != NULL && sender->body_decoded)) &&
+              frame_info == NULL) {
+            frame_info = spdy_add_frame_info(tvb, pinfo, offset, stream_id,
+                                             SPDY_DATA);
+          }
+          if (frame_info != NULL) {
+            frame_info->bodies_evicted = evicted;
+            if (sender != NULL && sender->body_decoded) {
+              frame_info->body_decoded_length = sender->decoded_length;
+              frame_info->body = spdy_get_entity_body(si, side);
+            }
           }
         }
       }
@@ -876,12 +3099,52 @@ static int dissect_spdy_data_payload(tvbuff_t *tvb,
       is_single_chunk = (num_data_frames == 1);
     }
 
-    if (!(frame->flags & SPDY_FLAG_FIN)) {
+    if (frame_info != NULL && frame_info->bodies_evicted != 0) {
+      expert_add_info_format(pinfo, spdy_proto, PI_REASSEMBLE, PI_WARN,
+                             "%u entity bodies dropped to stay within the "
+                             "%u KB body memory limit",
+                             frame_info->bodies_evicted,
+                             spdy_max_body_memory);
+    }
+
+    if (!last_chunk || !(frame->flags & SPDY_FLAG_FIN)) {
       col_set_fence(pinfo->cinfo, COL_INFO);
       col_add_fstr(pinfo->cinfo, COL_INFO, " (partial entity)");
       proto_item_append_text(spdy_proto, " (partial entity body)");
       /* would like the proto item to say */
       /* " (entity body fragment N of M)" */
+
+      /*
+       * Content-encoded bodies are decoded as they arrive, so show what
+       * has been decoded so far, in case the stream never finishes.
+       */
+      if (spdy_tree && frame_info != NULL &&
+          frame_info->body_decoded_length != 0) {
+        proto_tree_add_text(spdy_tree, tvb, offset, chunk_length,
+                            "[Uncompressed entity body so far: %u bytes]",
+                            frame_info->body_decoded_length);
+        body = frame_info->body == NULL ? NULL :
+            spdy_get_body(frame_info->body->body_id);
+        if (body != NULL && !body->spooled) {
+          const guint8 *decoded;
+          guint decoded_len;
+          tvbuff_t *decoded_tvb;
+
+          if (body->assembled_data != NULL) {
+            decoded_len = tvb_length(body->assembled_data);
+            decoded = tvb_get_ptr(body->assembled_data, 0, decoded_len);
+          } else {
+            decoded_len = body->data->len;
+            decoded = body->data->data;
+          }
+          decoded_len = MIN(decoded_len, frame_info->body_decoded_length);
+          decoded_tvb = tvb_new_child_real_data(tvb,
+                                                ep_memdup(decoded, decoded_len),
+                                                decoded_len, decoded_len);
+          add_new_data_source(pinfo, decoded_tvb,
+                              "Uncompressed entity body (partial)");
+        }
+      }
       goto body_dissected;
     }
     have_entire_body = is_single_chunk;
@@ -889,27 +3152,96 @@ static int dissect_spdy_data_payload(tvbuff_t *tvb,
      * On seeing the last data frame in a stream, we can
      * reassemble the frames into one data block.
      */
-    si = spdy_assemble_data_frames(conv_data, stream_id);
-    if (si == NULL) {
+    if (si != NULL) {
+      /*
+       * Nothing more will arrive from this side; keep what this frame
+       * needs, and let go of the stream altogether once it is closed.
+       */
+      if (frame_info == NULL) {
+        frame_info = spdy_add_frame_info(tvb, pinfo, offset, stream_id,
+                                         SPDY_DATA);
+      }
+      frame_info->body = spdy_finish_body(si, side);
+      if (stream_closed) {
+        spdy_discard_stream(conv_data, stream_id);
+      }
+    }
+    entity = frame_info == NULL ? NULL : frame_info->body;
+    if (entity == NULL) {
       goto body_dissected;
     }
-    data_tvb = si->assembled_data;
+    body = spdy_get_body(entity->body_id);
+    if (entity->body_evicted || (entity->body_id != 0 && body == NULL)) {
+      if (entity->spool_failed) {
+        expert_add_info_format(pinfo, spdy_proto, PI_REASSEMBLE, PI_WARN,
+                               "Entity body not reassembled: writing it to "
+                               "the spool file failed");
+      } else {
+        expert_add_info_format(pinfo, spdy_proto, PI_REASSEMBLE, PI_WARN,
+                               "Entity body not reassembled: it was dropped "
+                               "to stay within the %u KB body memory limit",
+                               spdy_max_body_memory);
+      }
+      goto body_dissected;
+    }
+    if (entity->skipped == SPDY_BODY_SKIPPED_TYPE) {
+      proto_tree_add_text(top_level_tree, tvb, offset, chunk_length,
+                          "[Entity body not reassembled: its content type "
+                          "is excluded by the body decoding preferences]");
+      goto body_dissected;
+    } else if (entity->skipped == SPDY_BODY_SKIPPED_SIZE) {
+      proto_tree_add_text(top_level_tree, tvb, offset, chunk_length,
+                          "[Entity body not reassembled: %" G_GINT64_MODIFIER
+                          "u bytes, over the %u KB body size limit]",
+                          entity->bytes_seen, spdy_max_body_size);
+      goto body_dissected;
+    }
+    if (entity->spool_path != NULL) {
+      /* Too big to keep around; it can only be exported. */
+      proto_tree_add_text(top_level_tree, tvb, offset, chunk_length,
+                          "[%s entity body: %u bytes, spooled to %s]",
+                          entity->body_decoded ? "Uncompressed" : "Assembled",
+                          entity->spooled_length, entity->spool_path);
+      spdy_queue_export_object(pinfo, entity, NULL);
+      goto body_dissected;
+    }
+    data_tvb = body == NULL ? NULL : body->assembled_data;
+    if (data_tvb != NULL && spdy_max_body_memory != 0) {
+      /*
+       * The body may yet be evicted while this frame is on display; show a
+       * copy that goes away with the frame instead.
+       */
+      data_tvb = spdy_tvb_child_copy(tvb, data_tvb);
+    }
     if (spdy_assemble_entity_bodies) {
       have_entire_body = TRUE;
     }
 
     if (!have_entire_body) {
+      if (data_tvb != NULL && entity->body_decoded) {
+        /* Only the start of the decoded body was kept. */
+        add_new_data_source(pinfo, data_tvb,
+                            "Uncompressed entity body (prefix)");
+        proto_tree_add_text(top_level_tree, data_tvb,
+                            0, tvb_length(data_tvb),
+                            "Content-encoded entity body (%s): %u bytes "
+                            "-> %u bytes (first %u bytes kept)",
+                            entity->content_encoding,
+                            entity->encoded_length,
+                            entity->decoded_length,
+                            tvb_length(data_tvb));
+      }
       goto body_dissected;
     }
 
     if (data_tvb == NULL) {
       data_tvb = next_tvb;
-    } else {
+    } else if (!entity->body_decoded) {
       add_new_data_source(pinfo, data_tvb, "Assembled entity body");
     }
 
-    if (have_entire_body && si->content_encoding != NULL &&
-        g_ascii_strcasecmp(si->content_encoding, "identity") != 0) {
+    if (have_entire_body && entity->content_encoding != NULL &&
+        g_ascii_strcasecmp(entity->content_encoding, "identity") != 0) {
       /*
        * We currently can't handle, for example, "compress";
        * just handle them as data for now.
@@ -923,12 +3255,20 @@ static int dissect_spdy_data_payload(tvbuff_t *tvb,
       proto_item *e_ti = NULL;
       proto_item *ce_ti = NULL;
       proto_tree *e_tree = NULL;
+      guint32 encoded_length;
 
-      if (spdy_decompress_body &&
-          (g_ascii_strcasecmp(si->content_encoding, "gzip") == 0 ||
-           g_ascii_strcasecmp(si->content_encoding, "deflate") == 0)) {
-        uncomp_tvb = spdy_tvb_child_uncompress(tvb, data_tvb, 0,
-                                               tvb_length(data_tvb));
+      if (entity->body_decoded) {
+        /* The body was already inflated as its DATA frames arrived. */
+        encoded_length = entity->encoded_length;
+        if (!entity->body_decode_failed) {
+          uncomp_tvb = data_tvb;
+        }
+      } else {
+        encoded_length = tvb_length(data_tvb);
+        if (spdy_body_is_deflated(entity->content_encoding)) {
+          uncomp_tvb = spdy_tvb_child_uncompress(tvb, data_tvb, 0,
+                                                 tvb_length(data_tvb));
+        }
       }
       /*
        * Add the encoded entity to the protocol tree
@@ -936,26 +3276,18 @@ static int dissect_spdy_data_payload(tvbuff_t *tvb,
       e_ti = proto_tree_add_text(top_level_tree, data_tvb,
                                  0, tvb_length(data_tvb),
                                  "Content-encoded entity body (%s): %u bytes",
-                                 si->content_encoding,
-                                 tvb_length(data_tvb));
+                                 entity->content_encoding,
+                                 encoded_length);
       e_tree = proto_item_add_subtree(e_ti, ett_spdy_encoded_entity);
-      if (si->num_data_frames > 1) {
-        GSList *dflist;
-        spdy_data_frame_t *df;
-        guint32 framenum;
+      if (entity->num_data_frames > 1) {
+        guint i;
+
         ce_ti = proto_tree_add_text(e_tree, data_tvb, 0,
                                     tvb_length(data_tvb),
                                     "Assembled from %d frames in packet(s)",
-                                    si->num_data_frames);
-        dflist = si->data_frames;
-        framenum = 0;
-        while (dflist != NULL) {
-          df = dflist->data;
-          if (framenum != df->framenum) {
-            proto_item_append_text(ce_ti, " #%u", df->framenum);
-            framenum = df->framenum;
-          }
-          dflist = g_slist_next(dflist);
+                                    entity->num_data_frames);
+        for (i = 0; i < entity->num_frames; i++) {
+          proto_item_append_text(ce_ti, " #%u", entity->frames[i]);
         }
       }
 
@@ -978,30 +3310,32 @@ static int dissect_spdy_data_payload(tvbuff_t *tvb,
         if (spdy_decompress_body) {
           proto_item_append_text(e_ti, " [Error: Decompression failed]");
         }
+        if (entity->body_decoded) {
+          add_new_data_source(pinfo, data_tvb,
+                              "Uncompressed entity body (partial)");
+        }
         call_dissector(data_handle, data_tvb, pinfo, e_tree);
 
         goto body_dissected;
       }
     }
-    if (si != NULL) {
-      spdy_discard_data_frames(si);
+    if (have_entire_body) {
+      spdy_queue_export_object(pinfo, entity, data_tvb);
     }
+
     /*
      * Do subdissector checks.
      *
      * First, check whether some subdissector asked that they
      * be called if something was on some particular port.
      */
-
-    port_subdissector_table = find_dissector_table("http.port");
-    media_type_subdissector_table = find_dissector_table("media_type");
     if (have_entire_body && port_subdissector_table != NULL) {
       handle = dissector_get_port_handle(port_subdissector_table,
                                          pinfo->match_port);
     } else {
       handle = NULL;
     }
-    if (handle == NULL && have_entire_body && si->content_type != NULL &&
+    if (handle == NULL && have_entire_body && entity->content_type != NULL &&
       media_type_subdissector_table != NULL) {
       /*
        * We didn't find any subdissector that
@@ -1012,19 +3346,18 @@ static int dissect_spdy_data_payload(tvbuff_t *tvb,
       save_private_data = pinfo->private_data;
       private_data_changed = TRUE;
 
-      if (si->content_type_parameters) {
-        pinfo->private_data = ep_strdup(si->content_type_parameters);
+      if (entity->content_type_parameters) {
+        pinfo->private_data = ep_strdup(entity->content_type_parameters);
       } else {
         pinfo->private_data = NULL;
       }
       /*
        * Calling the string handle for the media type
        * dissector table will set pinfo->match_string
-       * to si->content_type for us.
+       * to entity->content_type for us.
        */
-      pinfo->match_string = si->content_type;
-      handle = dissector_get_string_handle(media_type_subdissector_table,
-                                           si->content_type);
+      pinfo->match_string = entity->content_type;
+      handle = spdy_get_media_handle(entity->content_type);
     }
     if (handle != NULL) {
       /*
@@ -1035,7 +3368,7 @@ static int dissect_spdy_data_payload(tvbuff_t *tvb,
       dissected = FALSE;
     }
 
-    if (!dissected && have_entire_body && si->content_type != NULL) {
+    if (!dissected && have_entire_body && entity->content_type != NULL) {
       /*
        * Calling the default media handle if there is a content-type that
        * wasn't handled above.
@@ -1055,164 +3388,413 @@ body_dissected:
         pinfo->private_data = save_private_data;
     }
     /*
-     * We've processed frame->length bytes worth of data
+     * We've processed chunk_length bytes worth of data
      * (which may be no data at all); advance the
      * offset past whatever data we've processed.
      */
   }
-  return frame->length;
+  return chunk_length;
 }
 
 /*
  * Performs header decompression.
  *
- * The returned buffer is automatically scoped to the lifetime of the capture
+ * Inflation happens into a per-conversation scratch buffer which is grown
+ * as needed, so that header blocks of any size are inflated completely. The
+ * returned buffer is automatically scoped to the lifetime of the capture
  * (via se_memdup()).
  */
 static guint8* spdy_decompress_header_block(tvbuff_t *tvb,
+                                            spdy_conv_t *conv_data,
                                             z_streamp decomp,
-                                            guint32 dictionary_id,
                                             int offset,
                                             guint32 length,
                                             guint *uncomp_length) {
-  int retcode;
-  size_t bufsize = 16384;
-  const guint8 *hptr = tvb_get_ptr(tvb, offset, length);
-  guint8 *uncomp_block = ep_alloc(bufsize);
-  decomp->next_in = (Bytef *)hptr;
-  decomp->avail_in = length;
-  decomp->next_out = uncomp_block;
-  decomp->avail_out = bufsize;
-  retcode = inflate(decomp, Z_SYNC_FLUSH);
-  if (retcode == Z_NEED_DICT) {
-    if (decomp->adler != dictionary_id) {
-      printf("decompressor wants dictionary %#x, but we have %#x\n",
-             (guint)decomp->adler, dictionary_id);
-    } else {
-      retcode = inflateSetDictionary(decomp,
-                                     spdy_dictionary,
-                                     sizeof(spdy_dictionary));
-      if (retcode == Z_OK) {
-        retcode = inflate(decomp, Z_SYNC_FLUSH);
-      }
-    }
+  if (!spdy_inflate_header_block(decomp, tvb_get_ptr(tvb, offset, length),
+                                 length, &conv_data->inflate_buf,
+                                 uncomp_length, spdy_counted_header_inflate,
+                                 NULL)) {
+    return NULL;
   }
+  return se_memdup(conv_data->inflate_buf.data, *uncomp_length);
+}
 
-  /* Handle errors. */
-  if (retcode != Z_OK) {
-    return NULL;
+/*
+ * Returns where the inflater for a given header block is kept.
+ */
+static z_streamp *spdy_header_decompressor_slot(spdy_conv_t *conv_data,
+                                                guint32 stream_id,
+                                                guint16 type) {
+  if (stream_id % 2 == 0) {
+    /* Even streams are server-initiated and should never get a
+     * client-initiated header block. Use reply decompressor. */
+    return &conv_data->rply_decompressor;
+  } else if (type == SPDY_HEADERS) {
+    /* Odd streams are client-initiated, but may have HEADERS from either
+     * side. Currently, no known clients send HEADERS so we assume they are
+     * all from the server. */
+    return &conv_data->rply_decompressor;
+  } else if (type == SPDY_SYN_STREAM) {
+    return &conv_data->rqst_decompressor;
+  } else if (type == SPDY_SYN_REPLY) {
+    return &conv_data->rply_decompressor;
   }
+  /* Unhandled case. This should never happen. */
+  assert(FALSE);
+  return &conv_data->rply_decompressor;
+}
 
-  /* Handle successful inflation. */
-  *uncomp_length = bufsize - decomp->avail_out;
-  if (decomp->avail_in != 0) {
-    if (spdy_debug) {
-      printf("Inflation SUCCEEDED. Uncompressed size=%d but there were %d "
-             "input bytes left over\n", *uncomp_length, decomp->avail_in);
+/*
+ * Returns the inflater kept in a given slot, setting it up on the first
+ * header block it has to inflate, or NULL if there is none to be had.
+ */
+static z_streamp spdy_header_decompressor(spdy_conv_t *conv_data,
+                                          z_streamp *decomp_slot) {
+  if (*decomp_slot == NULL && !conv_data->decompressors_released) {
+    *decomp_slot = spdy_get_decompressor();
+    if (*decomp_slot != NULL &&
+        (conv_data->rqst_decompressor == NULL ||
+         conv_data->rply_decompressor == NULL) &&
+        ++spdy_perf.conversations_inflating >
+        spdy_perf.conversations_inflating_peak) {
+      spdy_perf.conversations_inflating_peak =
+          spdy_perf.conversations_inflating;
     }
   }
-  return se_memdup(uncomp_block, *uncomp_length);
+  return *decomp_slot;
 }
 
-/* TODO(cbentzel): Change wireshark to export p_remove_proto_data, rather
- * than duplicating code here. */
-typedef struct _spdy_frame_proto_data {
-  int proto;
-  void *proto_data;
-} spdy_frame_proto_data;
+/*
+ * Inflates, from the start, the header blocks of a conversation that were
+ * read from the cache, so that its inflaters have seen every block ahead
+ * of the first that wasn't cached. Their inflated copies replace the
+ * cached ones.
+ */
+static gboolean spdy_reinflate_cached_blocks(spdy_conv_t *conv_data) {
+  GSList *list;
+  gboolean ok = TRUE;
+
+  conv_data->cached_blocks = g_slist_reverse(conv_data->cached_blocks);
+  for (list = conv_data->cached_blocks; list != NULL;
+       list = g_slist_next(list)) {
+    spdy_cached_block_t *block = list->data;
+    z_streamp decomp;
+    guint uncomp_length;
+
+    if (ok) {
+      decomp = spdy_header_decompressor(conv_data, block->decomp_slot);
+      ok = decomp != NULL &&
+          spdy_inflate_header_block(decomp, block->comp, block->comp_length,
+                                    &conv_data->inflate_buf, &uncomp_length,
+                                    spdy_counted_header_inflate, NULL);
+      if (ok) {
+        block->frame_info->header_block =
+            se_memdup(conv_data->inflate_buf.data, uncomp_length);
+        block->frame_info->header_block_len = uncomp_length;
+      }
+    }
+    g_free(block);
+  }
+  g_slist_free(conv_data->cached_blocks);
+  conv_data->cached_blocks = NULL;
+  return ok;
+}
 
-static gint spdy_p_compare(gconstpointer a, gconstpointer b) {
-  const spdy_frame_proto_data *ap = (const spdy_frame_proto_data *)a;
-  const spdy_frame_proto_data *bp = (const spdy_frame_proto_data *)b;
+/*
+ * Returns the pooled copy of a string, adding it to the pool the first
+ * time it is seen. The copy lasts until the capture is closed.
+ */
+static const gchar *spdy_intern(const gchar *str) {
+  gchar *interned;
 
-  if (ap -> proto > bp -> proto) {
-    return 1;
-  } else if (ap -> proto == bp -> proto) {
-    return 0;
-  } else {
-    return -1;
+  if (str == NULL) {
+    return NULL;
   }
+  interned = g_hash_table_lookup(spdy_string_pool, str);
+  if (interned == NULL) {
+    interned = g_strdup(str);
+    g_hash_table_insert(spdy_string_pool, interned, interned);
+  }
+  return interned;
 }
 
-static void spdy_p_remove_proto_data(frame_data *fd, int proto) {
-  spdy_frame_proto_data temp;
-  GSList *item;
+/*
+ * Given a content type string that may contain optional parameters,
+ * return the parameter string, if any, otherwise return NULL. This
+ * also has the side effect of null terminating the content type
+ * part of the original string.
+ */
+static gchar* spdy_split_content_type(gchar *content_type) {
+  gchar *cp = content_type;
+
+  while (*cp != '\0' && *cp != ';' && !isspace(*cp)) {
+    *cp = tolower(*cp);
+    ++cp;
+  }
+  if (*cp == '\0') {
+    cp = NULL;
+  }
+
+  if (cp != NULL) {
+    *cp++ = '\0';
+    while (*cp == ';' || isspace(*cp)) {
+      ++cp;
+    }
+    if (*cp != '\0') {
+      return cp;
+    }
+  }
+  return NULL;
+}
 
-  temp.proto = proto;
-  temp.proto_data = NULL;
+/*
+ * Parses a Content-Type header value into its lowercased media type and
+ * its parameters, both interned. Each distinct value is parsed only once.
+ */
+static const spdy_content_type_t *spdy_parse_content_type(
+    const gchar *value) {
+  spdy_content_type_t *ct;
+
+  ct = g_hash_table_lookup(spdy_content_types, value);
+  if (ct == NULL) {
+    gchar *media_type = ep_strdup(value);
+    gchar *parameters = spdy_split_content_type(media_type);
+
+    ct = g_malloc(sizeof(spdy_content_type_t));
+    ct->media_type = spdy_intern(media_type);
+    ct->parameters = spdy_intern(parameters);
+    ct->body_wanted = spdy_body_type_wanted(ct->media_type);
+    g_hash_table_insert(spdy_content_types, g_strdup(value), ct);
+  }
+  return ct;
+}
 
-  item = g_slist_find_custom(fd->pfd, (gpointer *)&temp, spdy_p_compare);
+/*
+ * The headers with fields of their own, including those whose values the
+ * dissector makes use of.
+ */
+typedef enum _spdy_header_id_t {
+  SPDY_HEADER_OTHER,
+  SPDY_HEADER_METHOD,
+  SPDY_HEADER_PATH,
+  SPDY_HEADER_VERSION,
+  SPDY_HEADER_HOST,
+  SPDY_HEADER_SCHEME,
+  SPDY_HEADER_STATUS,
+  SPDY_HEADER_CONTENT_TYPE,
+  SPDY_HEADER_CONTENT_ENCODING,
+  SPDY_HEADER_CONTENT_LENGTH,
+  SPDY_HEADER_USER_AGENT,
+  SPDY_HEADER_ACCEPT,
+  SPDY_HEADER_ACCEPT_ENCODING,
+  SPDY_HEADER_COOKIE,
+  SPDY_HEADER_SET_COOKIE,
+  SPDY_HEADER_REFERER,
+  SPDY_HEADER_LOCATION,
+  SPDY_HEADER_SERVER,
+  SPDY_HEADER_CACHE_CONTROL
+} spdy_header_id_t;
+
+/* The field for each known header, by spdy_header_id_t. */
+static int * const spdy_header_fields[] = {
+  NULL,
+  &hf_spdy_method,
+  &hf_spdy_path,
+  &hf_spdy_http_version,
+  &hf_spdy_host,
+  &hf_spdy_scheme,
+  &hf_spdy_status,
+  &hf_spdy_content_type,
+  &hf_spdy_content_encoding,
+  &hf_spdy_content_length,
+  &hf_spdy_user_agent,
+  &hf_spdy_accept,
+  &hf_spdy_accept_encoding,
+  &hf_spdy_cookie,
+  &hf_spdy_set_cookie,
+  &hf_spdy_referer,
+  &hf_spdy_location,
+  &hf_spdy_server,
+  &hf_spdy_cache_control
+};
 
-  if (item) {
-    fd->pfd = g_slist_remove(fd->pfd, item->data);
+/*
+ * Identifies a header from its name as found in the header block, which need
+ * not be null terminated. At most one known name is compared against,
+ * picked by the length of the name and the characters that tell the known
+ * names of that length apart.
+ */
+static spdy_header_id_t spdy_classify_header(const guint8 *name,
+                                             int length) {
+  const char *known;
+  spdy_header_id_t id;
+
+  switch (length) {
+    case 5:
+      if (name[1] == 'p') {
+        known = ":path";
+        id = SPDY_HEADER_PATH;
+      } else {
+        known = ":host";
+        id = SPDY_HEADER_HOST;
+      }
+      break;
+    case 6:
+      if (name[0] == 'a') {
+        known = "accept";
+        id = SPDY_HEADER_ACCEPT;
+      } else if (name[0] == 'c') {
+        known = "cookie";
+        id = SPDY_HEADER_COOKIE;
+      } else {
+        known = "server";
+        id = SPDY_HEADER_SERVER;
+      }
+      break;
+    case 7:
+      if (name[1] == 'm') {
+        known = ":method";
+        id = SPDY_HEADER_METHOD;
+      } else if (name[2] == 'c') {
+        known = ":scheme";
+        id = SPDY_HEADER_SCHEME;
+      } else if (name[0] == 'r') {
+        known = "referer";
+        id = SPDY_HEADER_REFERER;
+      } else {
+        known = ":status";
+        id = SPDY_HEADER_STATUS;
+      }
+      break;
+    case 8:
+      if (name[0] == 'l') {
+        known = "location";
+        id = SPDY_HEADER_LOCATION;
+      } else {
+        known = ":version";
+        id = SPDY_HEADER_VERSION;
+      }
+      break;
+    case 10:
+      if (name[0] == 'u') {
+        known = "user-agent";
+        id = SPDY_HEADER_USER_AGENT;
+      } else {
+        known = "set-cookie";
+        id = SPDY_HEADER_SET_COOKIE;
+      }
+      break;
+    case 12:
+      known = "content-type";
+      id = SPDY_HEADER_CONTENT_TYPE;
+      break;
+    case 13:
+      known = "cache-control";
+      id = SPDY_HEADER_CACHE_CONTROL;
+      break;
+    case 14:
+      known = "content-length";
+      id = SPDY_HEADER_CONTENT_LENGTH;
+      break;
+    case 15:
+      known = "accept-encoding";
+      id = SPDY_HEADER_ACCEPT_ENCODING;
+      break;
+    case 16:
+      known = "content-encoding";
+      id = SPDY_HEADER_CONTENT_ENCODING;
+      break;
+    default:
+      return SPDY_HEADER_OTHER;
   }
+  return memcmp(name, known, length) == 0 ? id : SPDY_HEADER_OTHER;
 }
 
 /*
- * Saves state on header data for a given stream.
+ * Adds an item for each of a header's values, which are separated by NULs.
  */
-static spdy_header_info_t* spdy_save_header_block(frame_data *fd,
-                                                  guint32 stream_id,
-                                                  guint16 frame_type,
-                                                  guint8 *header,
-                                                  guint length) {
-  GSList *filist = p_get_proto_data(fd, proto_spdy);
-  spdy_header_info_t *header_info = se_alloc(sizeof(spdy_header_info_t));
-  if (filist != NULL)
-    spdy_p_remove_proto_data(fd, proto_spdy);
-  header_info->stream_id = stream_id;
-  header_info->header_block = header;
-  header_info->header_block_len = length;
-  header_info->frame_type = frame_type;
-  filist = g_slist_append(filist, header_info);
-  p_add_proto_data(fd, proto_spdy, filist);
-  return header_info;
-  /* TODO(ers) these need to get deleted when no longer needed */
+static void spdy_add_header_value_items(proto_tree *tree,
+                                        int hf_value,
+                                        tvbuff_t *tvb,
+                                        int offset,
+                                        int length) {
+  int end = offset + length;
+
+  for (;;) {
+    int nul = tvb_find_guint8(tvb, offset, end - offset, '\0');
+    int value_end = nul == -1 ? end : nul;
+
+    proto_tree_add_item(tree, hf_value, tvb, offset, value_end - offset,
+                        ENC_ASCII|ENC_NA);
+    if (nul == -1) {
+      break;
+    }
+    offset = nul + 1;
+  }
 }
 
 /*
- * Retrieves saved state for a given stream.
+ * Adds a newly inflated header block to its connection's compression
+ * totals, on the first pass, and keeps the totals so far with the frame.
  */
-static spdy_header_info_t* spdy_find_saved_header_block(frame_data *fd,
-                                                        guint32 stream_id,
-                                                        guint16 frame_type) {
-  GSList *filist = p_get_proto_data(fd, proto_spdy);
-  while (filist != NULL) {
-      spdy_header_info_t *hi = filist->data;
-      if (hi->stream_id == stream_id && hi->frame_type == frame_type)
-          return hi;
-      filist = g_slist_next(filist);
+static void spdy_count_header_block(spdy_conv_t *conv_data,
+                                    spdy_frame_info_t *frame_info,
+                                    guint compressed_length) {
+  int idx;
+
+  conv_data->header_comp[2] += compressed_length;
+  conv_data->header_uncomp[2] += frame_info->header_block_len;
+  frame_info->conv_header_comp = conv_data->header_comp[2];
+  frame_info->conv_header_uncomp = conv_data->header_uncomp[2];
+  if (conv_data->direction == SPDY_DIRECTION_UNKNOWN) {
+    return;
   }
-  return NULL;
+  idx = conv_data->direction - 1;
+  conv_data->header_comp[idx] += compressed_length;
+  conv_data->header_uncomp[idx] += frame_info->header_block_len;
+  frame_info->dir_header_comp = conv_data->header_comp[idx];
+  frame_info->dir_header_uncomp = conv_data->header_uncomp[idx];
 }
 
 /*
- * Given a content type string that may contain optional parameters,
- * return the parameter string, if any, otherwise return NULL. This
- * also has the side effect of null terminating the content type
- * part of the original string.
+ * Adds the compressed and uncompressed sizes of a header block and their
+ * ratio, along with the connection's running totals.
  */
-static gchar* spdy_parse_content_type(gchar *content_type) {
-  gchar *cp = content_type;
+static void spdy_add_header_compression(proto_tree *tree,
+                                        tvbuff_t *tvb,
+                                        const spdy_frame_info_t *frame_info,
+                                        guint compressed_length) {
+  proto_item *ti;
 
-  while (*cp != '\0' && *cp != ';' && !isspace(*cp)) {
-    *cp = tolower(*cp);
-    ++cp;
+  if (tree == NULL) {
+    return;
   }
-  if (*cp == '\0') {
-    cp = NULL;
+  ti = proto_tree_add_uint(tree, hf_spdy_header_block_comp_len, tvb, 0, 0,
+                           compressed_length);
+  PROTO_ITEM_SET_GENERATED(ti);
+  ti = proto_tree_add_uint(tree, hf_spdy_header_block_uncomp_len, tvb, 0, 0,
+                           frame_info->header_block_len);
+  PROTO_ITEM_SET_GENERATED(ti);
+  if (compressed_length != 0) {
+    ti = proto_tree_add_double(tree, hf_spdy_header_block_ratio, tvb, 0, 0,
+                               (double)frame_info->header_block_len /
+                               compressed_length);
+    PROTO_ITEM_SET_GENERATED(ti);
   }
-
-  if (cp != NULL) {
-    *cp++ = '\0';
-    while (*cp == ';' || isspace(*cp)) {
-      ++cp;
-    }
-    if (*cp != '\0') {
-      return cp;
-    }
+  if (frame_info->dir_header_comp != 0) {
+    ti = proto_tree_add_uint64(tree, hf_spdy_dir_header_comp, tvb, 0, 0,
+                               frame_info->dir_header_comp);
+    PROTO_ITEM_SET_GENERATED(ti);
+    ti = proto_tree_add_uint64(tree, hf_spdy_dir_header_uncomp, tvb, 0, 0,
+                               frame_info->dir_header_uncomp);
+    PROTO_ITEM_SET_GENERATED(ti);
   }
-  return NULL;
+  ti = proto_tree_add_uint64(tree, hf_spdy_conv_header_comp, tvb, 0, 0,
+                             frame_info->conv_header_comp);
+  PROTO_ITEM_SET_GENERATED(ti);
+  ti = proto_tree_add_uint64(tree, hf_spdy_conv_header_uncomp, tvb, 0, 0,
+                             frame_info->conv_header_uncomp);
+  PROTO_ITEM_SET_GENERATED(ti);
 }
 
 static int dissect_spdy_header_payload(
@@ -1221,10 +3803,16 @@ static int dissect_spdy_header_payload(
     packet_info *pinfo,
     proto_tree *frame_tree,
     const spdy_control_frame_info_t *frame,
-    spdy_conv_t *conv_data) {
+    spdy_conv_t *conv_data,
+    spdy_tap_info_t *tap_info) {
   guint32 stream_id;
-  int header_block_length = frame->length;
+  int payload_offset = offset;
+  int header_block_length;
   int hdr_offset = 0;
+  spdy_header_frame_t fields;
+  guint32 associated_stream_id;
+  guint8 priority;
+  spdy_frame_info_t *saved_frame_info;
   tvbuff_t *header_tvb = NULL;
   const gchar *hdr_method = NULL;
   const gchar *hdr_path = NULL;
@@ -1232,18 +3820,44 @@ static int dissect_spdy_header_payload(
   const gchar *hdr_host = NULL;
   const gchar *hdr_scheme = NULL;
   const gchar *hdr_status = NULL;
-  gchar *content_type = NULL;
-  gchar *content_encoding = NULL;
-  guint32 num_headers = 0;
+  const gchar *content_type = NULL;
+  const gchar *content_encoding = NULL;
+  spdy_header_iter_t headers;
+  gboolean have_headers;
   proto_item *header_block_item = NULL;
   proto_tree *header_block_tree = NULL;
-  proto_item *ti = NULL;
+  gboolean want_info = spdy_info_wanted(pinfo);
+
+  /* Get the fields ahead of the header block. */
+  if (!spdy_parse_header_frame(frame->type,
+                               tvb_get_ptr(tvb, offset, frame->length),
+                               frame->length, &fields)) {
+    expert_add_info_format(pinfo, frame_tree, PI_MALFORMED, PI_ERROR,
+                           "Frame too short for its header block fields.");
+    return -1;
+  }
+  stream_id = fields.stream_id;
+  associated_stream_id = fields.associated_stream_id;
+  priority = fields.priority;
+  header_block_length = fields.header_block_length;
 
   /* Get stream id, which is present in all types of header frames. */
-  stream_id = get_spdy_stream_id(tvb, offset);
   dissect_spdy_stream_id(tvb, offset, pinfo, frame_tree);
   offset += 4;
 
+  /* Clients open the odd-numbered streams, servers the even ones. */
+  if (frame->type == SPDY_SYN_STREAM && !conv_data->client_known) {
+    if (stream_id % 2 == 1) {
+      SE_COPY_ADDRESS(&conv_data->client_addr, &pinfo->src);
+      conv_data->client_port = pinfo->srcport;
+    } else {
+      SE_COPY_ADDRESS(&conv_data->client_addr, &pinfo->dst);
+      conv_data->client_port = pinfo->destport;
+    }
+    conv_data->client_known = TRUE;
+    conv_data->direction = spdy_get_direction(conv_data, pinfo);
+  }
+
   /* Get SYN_STREAM-only fields. */
   if (frame->type == SPDY_SYN_STREAM) {
     /* Get associated stream ID. */
@@ -1263,21 +3877,6 @@ static int dissect_spdy_header_payload(
     offset += 2;
   }
 
-
-  /* Get our header block length. */
-  switch (frame->type) {
-    case SPDY_SYN_STREAM:
-      header_block_length -= 10;
-      break;
-    case SPDY_SYN_REPLY:
-    case SPDY_HEADERS:
-      header_block_length -= 4;
-      break;
-    default:
-      /* Unhandled case. This should never happen. */
-      assert(FALSE);
-  }
-
   if (frame_tree) {
     /* Add the header block. */
     header_block_item = proto_tree_add_item(frame_tree,
@@ -1295,196 +3894,298 @@ static int dissect_spdy_header_payload(
       header_tvb = tvb;
       hdr_offset = offset;
   } else {
-    spdy_header_info_t *header_info;
+    spdy_frame_info_t *frame_info;
 
-    /* First attempt to find previously decompressed data.
-     * This will not work correctly for lower-level frames that contain more
-     * than one SPDY frame of the same type. We assume this to never be the
-     * case, though. */
-    header_info = spdy_find_saved_header_block(pinfo->fd,
-                                               stream_id,
-                                               frame->type);
+    /* First attempt to find previously decompressed data. */
+    frame_info = spdy_get_frame_info(tvb, pinfo, payload_offset);
 
     /* Generate decompressed data and store it, since none was found. */
-    if (header_info == NULL) {
+    if (frame_info == NULL) {
       guint uncomp_length = 0;
+      z_streamp *decomp_slot;
       z_streamp decomp;
-      guint8 *uncomp_ptr;
-
-      /* Get our decompressor. */
-      if (stream_id % 2 == 0) {
-        /* Even streams are server-initiated and should never get a
-         * client-initiated header block. Use reply decompressor. */
-        decomp = conv_data->rply_decompressor;
-      } else if (frame->type == SPDY_HEADERS) {
-        /* Odd streams are client-initiated, but may have HEADERS from either
-         * side. Currently, no known clients send HEADERS so we assume they are
-         * all from the server. */
-        decomp = conv_data->rply_decompressor;
-      } else if (frame->type == SPDY_SYN_STREAM) {
-        decomp = conv_data->rqst_decompressor;
-      } else if (frame->type == SPDY_SYN_REPLY) {
-        decomp = conv_data->rply_decompressor;
+      const guint8 *uncomp_ptr = NULL;
+      const spdy_header_cache_rec_t *rec = NULL;
+
+      decomp_slot = spdy_header_decompressor_slot(conv_data, stream_id,
+                                                  frame->type);
+
+      /*
+       * A block cached by an earlier dissection needs no inflating, so long
+       * as every one ahead of it in its conversation was cached too.
+       */
+      if (!spdy_header_cache.looked_up) {
+        spdy_header_cache_open(pinfo, tvb);
+      }
+      if (conv_data->cache_use == SPDY_HEADER_CACHE_UNDECIDED) {
+        conv_data->cache_use = spdy_header_cache_use(conv_data);
+      }
+      if (conv_data->cache_use == SPDY_HEADER_CACHE_READING) {
+        rec = spdy_header_cache_lookup(pinfo, payload_offset, tvb, offset,
+                                       header_block_length, conv_data);
+        if (rec == NULL) {
+          /* The cache file is short of this conversation's blocks. */
+          if (spdy_debug) {
+            printf("Header block in frame %u not cached; inflating its "
+                   "conversation from frame %u\n", pinfo->fd->num,
+                   conv_data->first_frame);
+          }
+          spdy_header_cache.stale = TRUE;
+          conv_data->cache_use = SPDY_HEADER_CACHE_INFLATING;
+          if (!spdy_reinflate_cached_blocks(conv_data)) {
+            /* Its inflaters are now of no use for the blocks to come. */
+            spdy_release_decompressors(conv_data);
+          }
+        }
+      }
+
+      if (rec != NULL) {
+        uncomp_ptr = (const guint8 *)
+            g_mapped_file_get_contents(spdy_header_cache.map) +
+            rec->data_offset + rec->comp_length;
+        uncomp_length = rec->uncomp_length;
+        spdy_perf.header_blocks_from_cache++;
       } else {
-        /* Unhandled case. This should never happen. */
-        assert(FALSE);
-      }
-
-      /* Decompress. */
-      uncomp_ptr = spdy_decompress_header_block(tvb,
-                                                decomp,
-                                                conv_data->dictionary_id,
-                                                offset,
-                                                header_block_length,
-                                                &uncomp_length);
-
-      /* Catch decompression failures. */
-      if (uncomp_ptr == NULL) {
-        expert_add_info_format(pinfo, frame_tree, PI_UNDECODED, PI_ERROR,
-                               "Inflation failed. Aborting.");
-        if (frame_tree) {
-          proto_item_append_text(frame_tree,
-                                 " [Error: Header decompression failed]");
+        /* Decompress. */
+        decomp = spdy_header_decompressor(conv_data, decomp_slot);
+        if (decomp != NULL) {
+          uncomp_ptr = spdy_decompress_header_block(tvb,
+                                                    conv_data,
+                                                    decomp,
+                                                    offset,
+                                                    header_block_length,
+                                                    &uncomp_length);
         }
-        return -1;
+
+        /* Catch decompression failures. */
+        if (uncomp_ptr == NULL) {
+          conv_data->cache_incomplete = TRUE;
+          expert_add_info_format(pinfo, frame_tree, PI_UNDECODED, PI_ERROR,
+                                 "Inflation failed. Aborting.");
+          if (frame_tree) {
+            proto_item_append_text(frame_tree,
+                                   " [Error: Header decompression failed]");
+          }
+          return -1;
+        }
+        spdy_header_cache_store(pinfo, payload_offset, tvb, offset,
+                                header_block_length, conv_data, uncomp_ptr,
+                                uncomp_length);
       }
 
       /* Store decompressed data. */
-      header_info = spdy_save_header_block(pinfo->fd,
-                                           stream_id,
-                                           frame->type,
-                                           uncomp_ptr,
-                                           uncomp_length);
+      frame_info = spdy_add_frame_info(tvb, pinfo, payload_offset, stream_id,
+                                       frame->type);
+      frame_info->header_block = uncomp_ptr;
+      frame_info->header_block_len = uncomp_length;
+      if (rec != NULL) {
+        spdy_cached_block_t *block = g_malloc(sizeof(spdy_cached_block_t));
+
+        block->frame_info = frame_info;
+        block->decomp_slot = decomp_slot;
+        block->comp = (const guint8 *)
+            g_mapped_file_get_contents(spdy_header_cache.map) +
+            rec->data_offset;
+        block->comp_length = rec->comp_length;
+        conv_data->cached_blocks = g_slist_prepend(conv_data->cached_blocks,
+                                                   block);
+      }
+      spdy_count_header_block(conv_data, frame_info, header_block_length);
+      spdy_perf.header_blocks_cached++;
+      spdy_perf.header_bytes_cached += uncomp_length;
     }
 
     /* Create a tvb containing the uncompressed data. */
     header_tvb = tvb_new_child_real_data(tvb,
-                                         header_info->header_block,
-                                         header_info->header_block_len,
-                                         header_info->header_block_len);
+                                         frame_info->header_block,
+                                         frame_info->header_block_len,
+                                         frame_info->header_block_len);
     add_new_data_source(pinfo, header_tvb, "Uncompressed headers");
     hdr_offset = 0;
+    spdy_add_header_compression(header_block_tree, tvb, frame_info,
+                                header_block_length);
+    if (tap_info != NULL) {
+      tap_info->header_block_uncomp_len = frame_info->header_block_len;
+      tap_info->payload = frame_info->header_block;
+      tap_info->payload_len = frame_info->header_block_len;
+      tap_info->dir_header_comp = frame_info->dir_header_comp;
+      tap_info->dir_header_uncomp = frame_info->dir_header_uncomp;
+      tap_info->conv_header_comp = frame_info->conv_header_comp;
+      tap_info->conv_header_uncomp = frame_info->conv_header_uncomp;
+    }
+  }
+  if (tap_info != NULL) {
+    tap_info->header_block_len = header_block_length;
   }
 
   /* Get header block details. */
   if (header_tvb == NULL || !spdy_decompress_headers) {
-    num_headers = 0;
+    have_headers = FALSE;
   } else {
-    num_headers = tvb_get_ntohl(header_tvb, hdr_offset);
-    ti = proto_tree_add_item(frame_tree,
-                             hf_spdy_num_headers,
-                             header_tvb,
-                             hdr_offset,
-                             4,
-                             ENC_BIG_ENDIAN);
+    guint32 block_len = tvb_length_remaining(header_tvb, hdr_offset);
+
+    have_headers = spdy_header_iter_init(&headers,
+                                         tvb_get_ptr(header_tvb, hdr_offset,
+                                                     block_len),
+                                         block_len);
+    if (!have_headers) {
+      expert_add_info_format(pinfo, frame_tree, PI_MALFORMED, PI_ERROR,
+                             "Not enough frame data for number of headers.");
+    } else {
+      proto_tree_add_item(frame_tree,
+                          hf_spdy_num_headers,
+                          header_tvb,
+                          hdr_offset,
+                          4,
+                          ENC_BIG_ENDIAN);
+    }
   }
-  hdr_offset += 4;
 
   /* Process headers. */
-  while (num_headers--) {
-    gchar *header_name;
-    const gchar *header_value;
+  while (have_headers) {
+    spdy_header_status_t status;
+    spdy_header_id_t header_id;
+    gboolean want_value;
+    const gchar *header_value = NULL;
     proto_tree *header_tree;
     proto_item *header;
     proto_item *header_name_ti;
     proto_item *header_value_ti;
     int header_name_offset;
     int header_value_offset;
-    int header_name_length;
-    int header_value_length;
+    guint32 header_name_length;
+    guint32 header_value_length;
 
-    /* Get header name details. */
-    if (tvb_length_remaining(header_tvb, hdr_offset) < 4) {
-      expert_add_info_format(pinfo, frame_tree, PI_MALFORMED, PI_ERROR,
-                             "Not enough frame data for header name size.");
+    /* Get header name and value details. */
+    status = spdy_header_iter_next(&headers);
+    if (status == SPDY_HEADER_END) {
       break;
     }
-    header_name_offset = hdr_offset;
-    header_name_length = tvb_get_ntohl(header_tvb, hdr_offset);
-    hdr_offset += 4;
-    if (tvb_length_remaining(header_tvb, hdr_offset) < header_name_length) {
+    if (status != SPDY_HEADER_PAIR) {
       expert_add_info_format(pinfo, frame_tree, PI_MALFORMED, PI_ERROR,
-                             "Not enough frame data for header name.");
+                             "Not enough frame data for header %s.",
+                             val_to_str(status, header_status_names,
+                                        "data"));
       break;
     }
-    header_name = (gchar *)tvb_get_ephemeral_string(header_tvb,
-                                                    hdr_offset,
-                                                    header_name_length);
-    hdr_offset += header_name_length;
+    header_name_offset = hdr_offset + headers.name_offset;
+    header_name_length = headers.name_length;
+    header_value_offset = hdr_offset + headers.value_offset;
+    header_value_length = headers.value_length;
+    header_id = spdy_classify_header(headers.name, header_name_length);
 
-    /* Get header value details. */
-    if (tvb_length_remaining(header_tvb, hdr_offset) < 4) {
-      expert_add_info_format(pinfo, frame_tree, PI_MALFORMED, PI_ERROR,
-                             "Not enough frame data for header value size.");
-      break;
+    /*
+     * Only copy out the values that will be used: all of them for the
+     * tree, the request/response line for the Info column, and the
+     * content headers when first seeing the stream.
+     */
+    switch (header_id) {
+      case SPDY_HEADER_PATH:
+      case SPDY_HEADER_HOST:
+      case SPDY_HEADER_CONTENT_TYPE:
+      case SPDY_HEADER_CONTENT_ENCODING:
+        want_value = want_info || !pinfo->fd->flags.visited;
+        break;
+      case SPDY_HEADER_METHOD:
+      case SPDY_HEADER_VERSION:
+      case SPDY_HEADER_SCHEME:
+      case SPDY_HEADER_STATUS:
+        want_value = want_info;
+        break;
+      default:
+        want_value = FALSE;
+        break;
     }
-    header_value_offset = hdr_offset;
-    header_value_length = tvb_get_ntohl(header_tvb, hdr_offset);
-    hdr_offset += 4;
-    if (tvb_length_remaining(header_tvb, hdr_offset) < header_value_length) {
-      expert_add_info_format(pinfo, frame_tree, PI_MALFORMED, PI_ERROR,
-                             "Not enough frame data for header value.");
-      break;
+    if (frame_tree || want_value) {
+      header_value = (gchar *)tvb_get_ephemeral_string(header_tvb,
+                                                       header_value_offset + 4,
+                                                       header_value_length);
     }
-    header_value = (gchar *)tvb_get_ephemeral_string(header_tvb,
-                                                     hdr_offset,
-                                                     header_value_length);
-    hdr_offset += header_value_length;
 
     /* Populate tree with header name/value details. */
     if (frame_tree) {
+      const gchar *header_name = (gchar *)tvb_get_ephemeral_string(
+          header_tvb, header_name_offset + 4, header_name_length);
+      int hf_value;
+
       /* Add 'Header' subtree with description. */
       header = proto_tree_add_item(frame_tree,
                                    hf_spdy_header,
                                    header_tvb,
                                    header_name_offset,
-                                   hdr_offset - header_name_offset,
+                                   header_value_offset + 4 +
+                                   header_value_length - header_name_offset,
                                    ENC_NA);
       proto_item_append_text(header, ": %s: %s", header_name, header_value);
       header_tree = proto_item_add_subtree(header, ett_spdy_header);
 
-      /* Add header name. */
+      /*
+       * Add header name and value. These are counted strings, so the
+       * length given is that of the count; the items cover the string
+       * that follows as well.
+       */
       header_name_ti = proto_tree_add_item(header_tree,
                                            hf_spdy_header_name,
                                            header_tvb,
                                            header_name_offset,
                                            4,
-                                           ENC_NA);
-
-      /* Add header value. */
+                                           ENC_BIG_ENDIAN|ENC_ASCII);
       header_value_ti = proto_tree_add_item(header_tree,
                                             hf_spdy_header_value,
                                             header_tvb,
                                             header_value_offset,
                                             4,
-                                            ENC_NA);
+                                            ENC_BIG_ENDIAN|ENC_ASCII);
+
+      /* Add the header's own field, if it has one. */
+      if (header_id != SPDY_HEADER_OTHER) {
+        hf_value = *spdy_header_fields[header_id];
+      } else {
+        hf_value = spdy_custom_header_field(header_name);
+      }
+      if (hf_value != -1) {
+        spdy_add_header_value_items(header_tree, hf_value, header_tvb,
+                                    header_value_offset + 4,
+                                    header_value_length);
+      }
     }
 
     /*
      * TODO(ers) check that the header name contains only legal characters.
      */
     /* TODO(hkhalil): Make sure that prohibited headers aren't sent. */
-    if (g_strcmp0(header_name, ":method") == 0) {
-      hdr_method = header_value;
-    } else if (g_strcmp0(header_name, ":path") == 0) {
-      hdr_path = header_value;
-    } else if (g_strcmp0(header_name, ":version") == 0) {
-      hdr_version = header_value;
-    } else if (g_strcmp0(header_name, ":host") == 0) {
-      hdr_host = header_value;
-    } else if (g_strcmp0(header_name, ":scheme") == 0) {
-      hdr_scheme = header_value;
-    } else if (g_strcmp0(header_name, ":status") == 0) {
-      hdr_status = header_value;
-    } else if (g_strcmp0(header_name, "content-type") == 0) {
-      content_type = se_strdup(header_value);
-    } else if (g_strcmp0(header_name, "content-encoding") == 0) {
-      content_encoding = se_strdup(header_value);
+    switch (header_id) {
+      case SPDY_HEADER_METHOD:
+        hdr_method = header_value;
+        break;
+      case SPDY_HEADER_PATH:
+        hdr_path = header_value;
+        break;
+      case SPDY_HEADER_VERSION:
+        hdr_version = header_value;
+        break;
+      case SPDY_HEADER_HOST:
+        hdr_host = header_value;
+        break;
+      case SPDY_HEADER_SCHEME:
+        hdr_scheme = header_value;
+        break;
+      case SPDY_HEADER_STATUS:
+        hdr_status = header_value;
+        break;
+      case SPDY_HEADER_CONTENT_TYPE:
+        content_type = header_value;
+        break;
+      case SPDY_HEADER_CONTENT_ENCODING:
+        content_encoding = header_value;
+        break;
+      default:
+        break;
     }
   }
 
   /* Set Info column. */
-  if (hdr_version != NULL) {
+  if (want_info && hdr_version != NULL) {
     if (hdr_status == NULL) {
       col_append_fstr(pinfo->cinfo, COL_INFO, " Request=\"%s %s://%s%s %s\"",
                       hdr_method, hdr_scheme, hdr_host, hdr_path, hdr_version);
@@ -1498,11 +4199,80 @@ static int dissect_spdy_header_payload(
    * If we expect data on this stream, we need to remember the content
    * type and content encoding.
    */
-  if (content_type != NULL && !pinfo->fd->flags.visited) {
-    gchar *content_type_params = spdy_parse_content_type(content_type);
-    spdy_save_stream_info(conv_data, stream_id, content_type,
-                          content_type_params, content_encoding);
+  if (!pinfo->fd->flags.visited) {
+    spdy_stream_info_t *si;
+    spdy_frame_info_t *frame_info;
+
+    if (frame->type == SPDY_SYN_STREAM) {
+      si = spdy_get_or_create_stream_info(conv_data, stream_id);
+      /* Used to name the stream's body on export. */
+      si->common.host = spdy_intern(hdr_host);
+      si->common.path = hdr_path != NULL ? se_strdup(hdr_path) : NULL;
+      si->common.syn_stream_frame = pinfo->fd->num;
+      si->common.syn_stream_time = pinfo->fd->abs_ts;
+      si->common.opener_direction = conv_data->direction;
+      si->common.unidirectional =
+          (frame->flags & SPDY_FLAG_UNIDIRECTIONAL) != 0;
+      si->common.opener_fin = (frame->flags & SPDY_FLAG_FIN) != 0;
+      si->common.send_window[0] = conv_data->initial_window[0];
+      si->common.send_window[1] = conv_data->initial_window[1];
+      si->common.priority_known = TRUE;
+      si->common.priority = priority;
+      if (!si->common.opener_fin) {
+        spdy_start_sending(conv_data, si);
+      }
+      spdy_count_stream_opened(tvb, pinfo, conv_data, si, payload_offset);
+      if (si->common.unidirectional && associated_stream_id != 0) {
+        spdy_note_push(tvb, pinfo, conv_data, si, associated_stream_id,
+                       payload_offset);
+        if (si->common.opener_fin) {
+          /* Nothing but headers was pushed. */
+          frame_info = spdy_get_frame_info(tvb, pinfo, payload_offset);
+          spdy_end_push(tvb, pinfo, conv_data, si, payload_offset,
+                        SPDY_SYN_STREAM, SPDY_PUSH_COMPLETED, 0, &frame_info);
+        }
+      }
+    } else {
+      si = spdy_get_stream_info(conv_data, stream_id);
+      if (si == NULL && content_type != NULL) {
+        si = spdy_get_or_create_stream_info(conv_data, stream_id);
+      }
+      if (si != NULL) {
+        if (frame->type == SPDY_SYN_REPLY && !si->common.reply_seen &&
+            (frame->flags & SPDY_FLAG_FIN) == 0) {
+          spdy_start_sending(conv_data, si);
+        }
+        frame_info = spdy_get_frame_info(tvb, pinfo, payload_offset);
+        if (spdy_note_stream_milestones(tvb, pinfo, conv_data, si,
+                                        payload_offset, frame,
+                                        &frame_info)) {
+          /* Finished without a final DATA frame; nothing refers to it. */
+          spdy_discard_stream(conv_data, stream_id);
+          si = NULL;
+        }
+      }
+    }
+    if (si != NULL && content_type != NULL) {
+      const spdy_content_type_t *ct = spdy_parse_content_type(content_type);
+
+      int side = spdy_segment_side(pinfo);
+      spdy_body_sender_t *sender = &si->sender[side];
+
+      sender->content_type = ct->media_type;
+      sender->content_type_parameters = ct->parameters;
+      sender->content_encoding = spdy_intern(content_encoding);
+      if (!sender->policy_checked) {
+        sender->policy_checked = TRUE;
+        if (!ct->body_wanted) {
+          spdy_skip_body(si, side, SPDY_BODY_SKIPPED_TYPE);
+        }
+      }
+    }
   }
+  saved_frame_info = spdy_get_frame_info(tvb, pinfo, payload_offset);
+  spdy_add_stream_timing(frame_tree, tvb, saved_frame_info);
+  spdy_add_concurrency(pinfo, frame_tree, tvb, saved_frame_info);
+  spdy_add_push_info(pinfo, frame_tree, tvb, saved_frame_info);
 
   return frame->length;
 }
@@ -1512,15 +4282,38 @@ static int dissect_spdy_rst_stream_payload(
     int offset,
     packet_info *pinfo,
     proto_tree *frame_tree,
-    const spdy_control_frame_info_t *frame) {
+    const spdy_control_frame_info_t *frame,
+    spdy_conv_t *conv_data) {
   guint32 rst_status;
+  guint32 stream_id;
+  int payload_offset = offset;
+  spdy_frame_info_t *frame_info = NULL;
 
   /* Get stream ID and add to info column and tree. */
   dissect_spdy_stream_id(tvb, offset, pinfo, frame_tree);
+  stream_id = get_spdy_stream_id(tvb, offset);
+  rst_status = tvb_get_ntohl(tvb, offset + 4);
+  if (!pinfo->fd->flags.visited) {
+    spdy_stream_info_t *si = spdy_get_stream_info(conv_data, stream_id);
+
+    if (si != NULL) {
+      spdy_count_stream_closed(tvb, pinfo, conv_data, si, payload_offset,
+                               SPDY_RST_STREAM, &frame_info);
+      spdy_end_push(tvb, pinfo, conv_data, si, payload_offset, SPDY_RST_STREAM,
+                    conv_data->direction == si->common.opener_direction ?
+                    SPDY_PUSH_RESET : SPDY_PUSH_REFUSED,
+                    rst_status, &frame_info);
+    }
+    /* Nothing more will be seen on the stream. */
+    spdy_discard_stream(conv_data, stream_id);
+  } else {
+    frame_info = spdy_get_frame_info(tvb, pinfo, payload_offset);
+  }
+  spdy_add_concurrency(pinfo, frame_tree, tvb, frame_info);
+  spdy_add_push_info(pinfo, frame_tree, tvb, frame_info);
   offset += 4;
 
   /* Get status. */
-  rst_status = tvb_get_ntohl(tvb, offset);
   if (match_strval(rst_status, rst_stream_status_names) == NULL) {
     /* Handle boundary conditions. */
     expert_add_info_format(pinfo, frame_tree, PI_PROTOCOL, PI_ERROR,
@@ -1529,12 +4322,14 @@ static int dissect_spdy_rst_stream_payload(
   }
 
   /* Add status to info column. */
-  col_append_fstr(pinfo->cinfo,
-                  COL_INFO,
-                  " Status=%s)",
-                  val_to_str(rst_status,
-                             rst_stream_status_names,
-                             "Unknown (%d)"));
+  if (spdy_info_wanted(pinfo)) {
+    col_append_fstr(pinfo->cinfo,
+                    COL_INFO,
+                    " Status=%s)",
+                    val_to_str(rst_status,
+                               rst_stream_status_names,
+                               "Unknown (%d)"));
+  }
 
   /* Add proto item for rst_status. */
   if (frame_tree) {
@@ -1554,16 +4349,151 @@ static int dissect_spdy_rst_stream_payload(
   return frame->length;
 }
 
+static void spdy_adjust_stream_window(gpointer key _U_,
+                                      gpointer value,
+                                      gpointer user_data) {
+  spdy_stream_info_t *si = value;
+  const gint32 *adjustment = user_data;
+
+  if (si->common.syn_stream_frame != 0) {
+    si->common.send_window[adjustment[0]] += adjustment[1];
+  }
+}
+
+/*
+ * Applies an INITIAL_WINDOW_SIZE setting to the streams its owner's peer
+ * sends on, both new and already open. The owner is given by the direction
+ * it sends in.
+ */
+static void spdy_set_initial_window(spdy_conv_t *conv_data,
+                                    spdy_direction_t direction,
+                                    guint32 window) {
+  gint32 adjustment[2];
+
+  if (direction == SPDY_DIRECTION_UNKNOWN) {
+    /* Can't tell whose window this is. */
+    return;
+  }
+  adjustment[0] = direction == SPDY_DIRECTION_TO_SERVER ?
+      SPDY_DIRECTION_TO_CLIENT - 1 : SPDY_DIRECTION_TO_SERVER - 1;
+  adjustment[1] = (gint32)window - conv_data->initial_window[adjustment[0]];
+  conv_data->initial_window[adjustment[0]] = (gint32)window;
+  g_hash_table_foreach(conv_data->streams, spdy_adjust_stream_window,
+                       adjustment);
+}
+
+/*
+ * Drops the settings a SETTINGS frame's sender had persisted, on the first
+ * pass, as its CLEAR_SETTINGS flag asks. A persisted INITIAL_WINDOW_SIZE
+ * is undone too, going back to the default for new streams and adjusting
+ * open ones by the difference, as a new INITIAL_WINDOW_SIZE would.
+ */
+static void spdy_clear_persisted_settings(spdy_conv_t *conv_data) {
+  spdy_settings_t *settings;
+
+  if (conv_data->direction == SPDY_DIRECTION_UNKNOWN) {
+    return;
+  }
+  settings = &conv_data->settings[conv_data->direction - 1];
+  if (settings->present & settings->persisted &
+      (1 << SPDY_SETTINGS_INITIAL_WINDOW_SIZE)) {
+    spdy_set_initial_window(conv_data, conv_data->direction,
+                            SPDY_DEFAULT_INITIAL_WINDOW);
+  }
+  settings->present &= ~settings->persisted;
+  settings->persisted = 0;
+}
+
+/*
+ * Applies one entry of a SETTINGS frame, on the first pass. An entry
+ * flagged PERSISTED is handed back from an earlier session, so it's the
+ * setting of the peer, not of the frame's sender.
+ */
+static void spdy_apply_setting(spdy_conv_t *conv_data,
+                               guint8 flags,
+                               guint32 setting_id,
+                               guint32 setting_value) {
+  spdy_direction_t owner = conv_data->direction;
+  spdy_settings_t *settings;
+
+  if (owner == SPDY_DIRECTION_UNKNOWN) {
+    return;
+  }
+  if (flags & SPDY_FLAG_SETTINGS_PERSISTED) {
+    owner = owner == SPDY_DIRECTION_TO_SERVER ?
+        SPDY_DIRECTION_TO_CLIENT : SPDY_DIRECTION_TO_SERVER;
+  }
+  if (setting_id == SPDY_SETTINGS_INITIAL_WINDOW_SIZE) {
+    spdy_set_initial_window(conv_data, owner, setting_value);
+  }
+  if (setting_id >= SPDY_NUM_SETTINGS) {
+    return;
+  }
+  settings = &conv_data->settings[owner - 1];
+  settings->values[setting_id] = setting_value;
+  settings->present |= 1 << setting_id;
+  if (flags & (SPDY_FLAG_SETTINGS_PERSIST_VALUE |
+               SPDY_FLAG_SETTINGS_PERSISTED)) {
+    settings->persisted |= 1 << setting_id;
+  } else {
+    settings->persisted &= ~(1 << setting_id);
+  }
+}
+
+/*
+ * Adds the settings each side has in effect once a SETTINGS frame has been
+ * applied.
+ */
+static void spdy_add_effective_settings(proto_tree *tree,
+                                        tvbuff_t *tvb,
+                                        const spdy_frame_info_t *frame_info) {
+  static const gchar *owner_names[2] = { "client", "server" };
+  int idx;
+
+  if (tree == NULL || frame_info == NULL || frame_info->settings == NULL) {
+    return;
+  }
+  for (idx = 0; idx < 2; idx++) {
+    const spdy_settings_t *settings = &frame_info->settings[idx];
+    proto_item *ti;
+    proto_tree *settings_tree;
+    guint32 setting_id;
+
+    if (settings->present == 0) {
+      continue;
+    }
+    ti = proto_tree_add_text(tree, tvb, 0, 0, "Settings in effect (%s)",
+                             owner_names[idx]);
+    PROTO_ITEM_SET_GENERATED(ti);
+    settings_tree = proto_item_add_subtree(ti, ett_spdy_effective_settings);
+    for (setting_id = 0; setting_id < SPDY_NUM_SETTINGS; setting_id++) {
+      if (!(settings->present & (1 << setting_id))) {
+        continue;
+      }
+      ti = proto_tree_add_text(settings_tree, tvb, 0, 0, "%s: %u%s",
+                               val_to_str(setting_id, setting_id_names,
+                                          "Unknown(%d)"),
+                               settings->values[setting_id],
+                               (settings->persisted & (1 << setting_id)) ?
+                               " (persisted)" : "");
+      PROTO_ITEM_SET_GENERATED(ti);
+    }
+  }
+}
+
 static int dissect_spdy_settings_payload(
     tvbuff_t *tvb,
     int offset,
     packet_info *pinfo,
     proto_tree *frame_tree,
-    const spdy_control_frame_info_t *frame) {
+    const spdy_control_frame_info_t *frame,
+    spdy_conv_t *conv_data) {
   guint32 num_entries;
   proto_item *ti;
   proto_tree *setting_tree;
   proto_tree *flags_tree;
+  int payload_offset = offset;
+  gboolean info_wanted = spdy_info_wanted(pinfo);
 
   /* Make sure that we have enough room for our number of entries field. */
   if (frame->length < 4) {
@@ -1591,9 +4521,21 @@ static int dissect_spdy_settings_payload(
   }
   offset += 4;
 
+  /* Past the first pass, the entries are only of interest for display. */
+  if (!frame_tree && !info_wanted && pinfo->fd->flags.visited) {
+    return frame->length;
+  }
+
+  if (!pinfo->fd->flags.visited &&
+      (frame->flags & SPDY_FLAG_SETTINGS_CLEAR_SETTINGS)) {
+    spdy_clear_persisted_settings(conv_data);
+  }
+
   /* Dissect each entry. */
   while (num_entries > 0) {
-    const gchar *setting_id_str;
+    const gchar *setting_id_str = NULL;
+    guint8 setting_flags;
+    guint32 setting_id;
     guint32 setting_value;
 
     if (frame_tree) {
@@ -1608,6 +4550,7 @@ static int dissect_spdy_settings_payload(
     }
 
     /* Set flags. */
+    setting_flags = tvb_get_guint8(tvb, offset);
     if (frame_tree) {
       ti = proto_tree_add_item(setting_tree,
                                hf_spdy_flags,
@@ -1633,8 +4576,11 @@ static int dissect_spdy_settings_payload(
     offset += 1;
 
     /* Set ID. */
-    setting_id_str = val_to_str(tvb_get_ntoh24(tvb, offset), setting_id_names,
-                                "Unknown(%d)");
+    setting_id = tvb_get_ntoh24(tvb, offset);
+    if (frame_tree || info_wanted) {
+      setting_id_str = val_to_str(setting_id, setting_id_names,
+                                  "Unknown(%d)");
+    }
     if (frame_tree) {
       proto_tree_add_item(setting_tree,
                           hf_spdy_setting_id,
@@ -1662,24 +4608,82 @@ static int dissect_spdy_settings_payload(
     offset += 4;
 
     /* Append to info column. */
-    col_append_fstr(pinfo->cinfo, COL_INFO, " %s=%u", setting_id_str,
-                    setting_value);
+    if (info_wanted) {
+      col_append_fstr(pinfo->cinfo, COL_INFO, " %s=%u", setting_id_str,
+                      setting_value);
+    }
+
+    if (!pinfo->fd->flags.visited) {
+      spdy_apply_setting(conv_data, setting_flags, setting_id, setting_value);
+    }
 
     /* Increment. */
     --num_entries;
   }
 
+  if (!pinfo->fd->flags.visited) {
+    spdy_frame_info_t *frame_info = spdy_add_frame_info(tvb, pinfo,
+                                                        payload_offset, 0,
+                                                        SPDY_SETTINGS);
+
+    frame_info->settings = se_memdup(conv_data->settings,
+                                     sizeof(conv_data->settings));
+  }
+  spdy_add_effective_settings(frame_tree, tvb,
+                              spdy_get_frame_info(tvb, pinfo, payload_offset));
+
   return frame->length;
 }
 
+/*
+ * Pairs a PING with its echo on the first pass. The first PING seen with
+ * a given ID is taken to be the original, and the next one from the other
+ * side as its echo.
+ */
+static void spdy_match_ping(tvbuff_t *tvb,
+                            packet_info *pinfo,
+                            spdy_conv_t *conv_data,
+                            int offset,
+                            guint32 ping_id) {
+  spdy_direction_t direction = conv_data->direction;
+  spdy_ping_t *ping = g_hash_table_lookup(conv_data->pings,
+                                          GUINT_TO_POINTER(ping_id));
+  spdy_frame_info_t *frame_info = spdy_add_frame_info(tvb, pinfo, offset, 0,
+                                                      SPDY_PING);
+
+  if (ping != NULL &&
+      (direction == SPDY_DIRECTION_UNKNOWN || direction != ping->direction)) {
+    frame_info->ping_is_echo = TRUE;
+    frame_info->ping_match_frame = ping->frame_info->key.framenum;
+    nstime_delta(&frame_info->ping_rtt, &pinfo->fd->abs_ts, &ping->sent);
+    ping->frame_info->ping_match_frame = pinfo->fd->num;
+    g_hash_table_remove(conv_data->pings, GUINT_TO_POINTER(ping_id));
+    return;
+  }
+  ping = g_malloc(sizeof(spdy_ping_t));
+  ping->frame_info = frame_info;
+  ping->sent = pinfo->fd->abs_ts;
+  ping->direction = direction;
+  g_hash_table_replace(conv_data->pings, GUINT_TO_POINTER(ping_id), ping);
+}
+
 static int dissect_spdy_ping_payload(tvbuff_t *tvb,
                                      int offset,
                                      packet_info *pinfo,
                                      proto_tree *frame_tree,
-                                     const spdy_control_frame_info_t *frame) {
+                                     const spdy_control_frame_info_t *frame,
+                                     spdy_conv_t *conv_data) {
+  spdy_frame_info_t *frame_info;
+  proto_item *ti;
+
   /* Get ping ID. */
   guint32 ping_id = tvb_get_ntohl(tvb, offset);
 
+  if (!pinfo->fd->flags.visited) {
+    spdy_match_ping(tvb, pinfo, conv_data, offset, ping_id);
+  }
+  frame_info = spdy_get_frame_info(tvb, pinfo, offset);
+
   /* Add proto item for ping ID. */
   if (frame_tree) {
     proto_tree_add_item(frame_tree,
@@ -1690,10 +4694,32 @@ static int dissect_spdy_ping_payload(tvbuff_t *tvb,
                         ENC_BIG_ENDIAN);
     proto_item_append_text(frame_tree, ", ID: %u", ping_id);
   }
+  if (frame_info != NULL && frame_info->ping_is_echo) {
+    if (frame_tree) {
+      ti = proto_tree_add_uint(frame_tree, hf_spdy_ping_request_in, tvb, 0, 0,
+                               frame_info->ping_match_frame);
+      PROTO_ITEM_SET_GENERATED(ti);
+      ti = proto_tree_add_time(frame_tree, hf_spdy_ping_rtt, tvb, 0, 0,
+                               &frame_info->ping_rtt);
+      PROTO_ITEM_SET_GENERATED(ti);
+    }
+  } else if (frame_info != NULL && frame_info->ping_match_frame != 0) {
+    if (frame_tree) {
+      ti = proto_tree_add_uint(frame_tree, hf_spdy_ping_response_in, tvb, 0,
+                               0, frame_info->ping_match_frame);
+      PROTO_ITEM_SET_GENERATED(ti);
+    }
+  } else if (pinfo->fd->flags.visited) {
+    /* Only known once the whole capture has been seen. */
+    expert_add_info_format(pinfo, frame_tree, PI_SEQUENCE, PI_NOTE,
+                           "PING %u was not answered", ping_id);
+  }
   offset += 4;
 
   /* Add ping ID to info column. */
-  col_append_fstr(pinfo->cinfo, COL_INFO, " ID=%u", ping_id);
+  if (spdy_info_wanted(pinfo)) {
+    col_append_fstr(pinfo->cinfo, COL_INFO, " ID=%u", ping_id);
+  }
 
   return frame->length;
 }
@@ -1702,12 +4728,17 @@ static int dissect_spdy_goaway_payload(tvbuff_t *tvb,
                                        int offset,
                                        packet_info *pinfo,
                                        proto_tree *frame_tree,
-                                       const spdy_control_frame_info_t *frame) {
+                                       const spdy_control_frame_info_t *frame,
+                                       spdy_conv_t *conv_data) {
   guint32 goaway_status;
 
   /* Get last good stream ID and add to info column and tree. */
   dissect_spdy_stream_id_field(tvb, offset, pinfo, frame_tree,
                                hf_spdy_goaway_last_good_stream_id);
+  if (!pinfo->fd->flags.visited) {
+    /* Streams past the last good one won't be processed by the sender. */
+    spdy_discard_streams_above(conv_data, get_spdy_stream_id(tvb, offset));
+  }
   offset += 4;
 
   /* Get status. */
@@ -1720,12 +4751,14 @@ static int dissect_spdy_goaway_payload(tvbuff_t *tvb,
   }
 
   /* Add status to info column. */
-  col_append_fstr(pinfo->cinfo,
-                  COL_INFO,
-                  " Status=%s)",
-                  val_to_str(goaway_status,
-                             rst_stream_status_names,
-                             "Unknown (%d)"));
+  if (spdy_info_wanted(pinfo)) {
+    col_append_fstr(pinfo->cinfo,
+                    COL_INFO,
+                    " Status=%s)",
+                    val_to_str(goaway_status,
+                               rst_stream_status_names,
+                               "Unknown (%d)"));
+  }
 
   /* Add proto item for goaway_status. */
   if (frame_tree) {
@@ -1740,20 +4773,72 @@ static int dissect_spdy_goaway_payload(tvbuff_t *tvb,
   return frame->length;
 }
 
+/*
+ * Credits a WINDOW_UPDATE to the send window of its sender's peer, on the
+ * first pass.
+ */
+static void spdy_track_window_update(tvbuff_t *tvb,
+                                     packet_info *pinfo,
+                                     spdy_conv_t *conv_data,
+                                     int offset,
+                                     guint32 stream_id,
+                                     guint32 delta) {
+  spdy_direction_t direction = conv_data->direction;
+  spdy_frame_info_t *frame_info;
+  spdy_stream_info_t *si = NULL;
+  int idx;
+
+  if (direction == SPDY_DIRECTION_UNKNOWN) {
+    return;
+  }
+  idx = direction == SPDY_DIRECTION_TO_SERVER ?
+      SPDY_DIRECTION_TO_CLIENT - 1 : SPDY_DIRECTION_TO_SERVER - 1;
+  if (stream_id != 0) {
+    si = spdy_get_stream_info(conv_data, stream_id);
+    if (si == NULL || si->common.syn_stream_frame == 0) {
+      return;
+    }
+  }
+  frame_info = spdy_add_frame_info(tvb, pinfo, offset, stream_id,
+                                   SPDY_WINDOW_UPDATE);
+  if (si == NULL) {
+    conv_data->conn_flow_control = TRUE;
+    conv_data->conn_window[idx] += delta;
+    frame_info->has_conn_window = TRUE;
+    frame_info->conn_window = (gint32)conv_data->conn_window[idx];
+  } else {
+    si->common.send_window[idx] += delta;
+    frame_info->has_window = TRUE;
+    frame_info->window = (gint32)si->common.send_window[idx];
+  }
+}
+
 static int dissect_spdy_window_update_payload(
     tvbuff_t *tvb,
     int offset,
     packet_info *pinfo,
     proto_tree *frame_tree,
-    const spdy_control_frame_info_t *frame) {
+    const spdy_control_frame_info_t *frame,
+    spdy_conv_t *conv_data) {
+  int payload_offset = offset;
+  guint32             stream_id;
   guint32             window_update_delta;
 
   /* Get stream ID. */
+  stream_id = get_spdy_stream_id(tvb, offset);
   dissect_spdy_stream_id(tvb, offset, pinfo, frame_tree);
   offset += 4;
 
   /* Get window update delta. */
   window_update_delta = tvb_get_bits32(tvb, (offset * 8) + 1, 31, FALSE);
+  if (!pinfo->fd->flags.visited) {
+    spdy_track_window_update(tvb, pinfo, conv_data, payload_offset, stream_id,
+                             window_update_delta);
+  }
+  if (frame_tree) {
+    spdy_add_windows(pinfo, frame_tree, tvb,
+                     spdy_get_frame_info(tvb, pinfo, payload_offset));
+  }
 
   /* Add proto item for window update delta. */
   if (frame_tree) {
@@ -1768,12 +4853,33 @@ static int dissect_spdy_window_update_payload(
   offset += 4;
 
   /* Add delta to info column. */
-  col_append_fstr(pinfo->cinfo, COL_INFO, " Delta=%u",
-                      window_update_delta);
+  if (spdy_info_wanted(pinfo)) {
+    col_append_fstr(pinfo->cinfo, COL_INFO, " Delta=%u",
+                    window_update_delta);
+  }
 
   return frame->length;
 }
 
+/*
+ * Fills in a frame's tap record from the state kept with the frame.
+ */
+static void spdy_tap_frame_info(spdy_tap_info_t *tap_info,
+                                const spdy_frame_info_t *frame_info) {
+  if (frame_info == NULL) {
+    return;
+  }
+  if (frame_info->has_priority) {
+    tap_info->has_priority = TRUE;
+    tap_info->priority = frame_info->priority;
+    tap_info->bytes_ahead = frame_info->bytes_ahead;
+    tap_info->conv_priority_inversions = frame_info->conv_priority_inversions;
+    tap_info->conv_bytes_ahead = frame_info->conv_bytes_ahead;
+  }
+  tap_info->push_outcome = frame_info->push_outcome;
+  tap_info->pushed_bytes = frame_info->pushed_bytes;
+}
+
 /*
  * Performs SPDY frame dissection.
  */
@@ -1783,11 +4889,15 @@ int dissect_spdy_frame(tvbuff_t *tvb,
                        proto_tree *tree,
                        spdy_conv_t *conv_data) {
   guint8              control_bit;
+  spdy_frame_header_t hdr;
   spdy_control_frame_info_t frame;
   guint32             stream_id = 0;
   const gchar         *frame_type_name;
   proto_tree          *spdy_tree = NULL;
   proto_item          *spdy_proto = NULL;
+  spdy_tap_info_t     *tap_info = NULL;
+  int                 frame_len;
+  guint32             chunk_length;
 
   if (spdy_debug) {
     printf("Attempting dissection for frame #%d\n",
@@ -1797,14 +4907,19 @@ int dissect_spdy_frame(tvbuff_t *tvb,
   /*
    * Minimum size for a SPDY frame is 8 bytes.
    */
-  if (tvb_length_remaining(tvb, offset) < 8) {
+  if (tvb_length_remaining(tvb, offset) < SPDY_FRAME_HEADER_LEN) {
     expert_add_info_format(pinfo, tree, PI_MALFORMED, PI_ERROR,
                            "Reported length remaining too small (%d < 8)",
                            tvb_length_remaining(tvb, offset));
     return -1;
   }
-
-  col_set_str(pinfo->cinfo, COL_PROTOCOL, "SPDY");
+  spdy_parse_frame_header(tvb_get_ptr(tvb, offset, SPDY_FRAME_HEADER_LEN),
+                          &hdr);
+  frame.control_bit = hdr.control;
+  frame.version = hdr.version;
+  frame.type = hdr.type;
+  frame.flags = hdr.flags;
+  frame.length = hdr.length;
 
   /* Create SPDY tree elements. */
   if (tree) {
@@ -1819,7 +4934,7 @@ int dissect_spdy_frame(tvbuff_t *tvb,
   }
 
   /* Add control bit. */
-  control_bit = tvb_get_bits8(tvb, offset << 3, 1);
+  control_bit = hdr.control;
   if (spdy_tree) {
     dissect_spdy_control_bit(tvb, offset, spdy_tree);
   }
@@ -1827,7 +4942,6 @@ int dissect_spdy_frame(tvbuff_t *tvb,
   /* Process first four bytes of frame, formatted depending on control bit. */
   if (control_bit) {
     /* Add version. */
-    frame.version = tvb_get_bits16(tvb, (offset * 8) + 1, 15, FALSE);
     if (spdy_tree) {
       proto_tree_add_bits_item(spdy_tree,
                                hf_spdy_version,
@@ -1839,7 +4953,6 @@ int dissect_spdy_frame(tvbuff_t *tvb,
     offset += 2;
 
     /* Add control frame type. */
-    frame.type = tvb_get_ntohs(tvb, offset);
     if (frame.type >= SPDY_INVALID) {
       expert_add_info_format(pinfo, tree, PI_PROTOCOL, PI_ERROR,
                              "Invalid SPDY control frame type: %d",
@@ -1856,11 +4969,8 @@ int dissect_spdy_frame(tvbuff_t *tvb,
     }
     offset += 2;
   } else {
-    frame.type = SPDY_DATA;
-    frame.version = 0; /* Version doesn't apply to DATA. */
-
     /* Add stream ID. */
-    stream_id = get_spdy_stream_id(tvb, offset);
+    stream_id = hdr.stream_id;
     if (spdy_tree) {
       proto_tree_add_item(spdy_tree,
                           hf_spdy_streamid,
@@ -1873,21 +4983,21 @@ int dissect_spdy_frame(tvbuff_t *tvb,
   }
 
   /* Add frame info. */
-  frame_type_name = val_to_str(frame.type, frame_type_names, "Unknown(%d)");
-  col_add_str(pinfo->cinfo, COL_INFO, frame_type_name);
-  if (spdy_tree) {
-    proto_item_append_text(spdy_tree, ", %s", frame_type_name);
+  if (spdy_tree || spdy_info_wanted(pinfo)) {
+    frame_type_name = val_to_str(frame.type, frame_type_names, "Unknown(%d)");
+    col_add_str(pinfo->cinfo, COL_INFO, frame_type_name);
+    if (spdy_tree) {
+      proto_item_append_text(spdy_tree, ", %s", frame_type_name);
+    }
   }
 
   /* Add flags. */
-  frame.flags = tvb_get_guint8(tvb, offset);
   if (spdy_tree) {
     dissect_spdy_flags(tvb, offset, spdy_tree, &frame);
   }
   offset += 1;
 
   /* Add length. */
-  frame.length = tvb_get_ntoh24(tvb, offset);
   if (spdy_tree) {
     proto_item_set_len(spdy_proto, frame.length + 8);
     proto_tree_add_item(spdy_tree,
@@ -1900,18 +5010,29 @@ int dissect_spdy_frame(tvbuff_t *tvb,
   offset += 3;
 
   /*
-   * Make sure there's as much data as the frame header says there is.
+   * Make sure there's as much data as the frame header says there is. A
+   * DATA frame's payload may carry on into later segments; see
+   * dissect_spdy().
    */
-  if ((guint)tvb_length_remaining(tvb, offset) < frame.length) {
+  chunk_length = MIN(frame.length, (guint)tvb_length_remaining(tvb, offset));
+  if (chunk_length < frame.length && control_bit) {
     expert_add_info_format(pinfo, tree, PI_MALFORMED, PI_ERROR,
                            "Not enough frame data: %d vs. %d",
                            frame.length, tvb_length_remaining(tvb, offset));
     return -1;
   }
 
+  if (have_tap_listener(spdy_tap)) {
+    tap_info = ep_alloc0(sizeof(spdy_tap_info_t));
+    tap_info->type = frame.type;
+    tap_info->flags = frame.flags;
+    tap_info->length = frame.length;
+    tap_info->direction = conv_data->direction;
+  }
+
   /* Dissect DATA payload as necessary. */
   if (!control_bit) {
-    return offset + dissect_spdy_data_payload(tvb,
+    frame_len = 8 + dissect_spdy_data_payload(tvb,
                                               offset,
                                               pinfo,
                                               tree,
@@ -1919,7 +5040,21 @@ int dissect_spdy_frame(tvbuff_t *tvb,
                                               spdy_proto,
                                               conv_data,
                                               stream_id,
-                                              &frame);
+                                              &frame,
+                                              chunk_length,
+                                              TRUE,
+                                              chunk_length == frame.length);
+    spdy_add_stream_index(spdy_tree, tvb,
+                          spdy_index_stream_frame(pinfo, conv_data, stream_id),
+                          tap_info);
+    if (tap_info != NULL) {
+      spdy_tap_frame_info(tap_info, spdy_get_frame_info(tvb, pinfo, offset));
+      tap_info->stream_id = stream_id;
+      tap_info->payload = tvb_get_ptr(tvb, offset, chunk_length);
+      tap_info->payload_len = chunk_length;
+      tap_queue_packet(spdy_tap, pinfo, tap_info);
+    }
+    return frame_len;
   }
 
   /* Abort here if the version is too low. */
@@ -1938,7 +5073,7 @@ int dissect_spdy_frame(tvbuff_t *tvb,
     case SPDY_SYN_REPLY:
     case SPDY_HEADERS:
       if (0 > dissect_spdy_header_payload(tvb, offset, pinfo, spdy_tree,
-                                          &frame, conv_data)) {
+                                          &frame, conv_data, tap_info)) {
         return -1;
       }
 
@@ -1946,35 +5081,35 @@ int dissect_spdy_frame(tvbuff_t *tvb,
 
     case SPDY_RST_STREAM:
       if (0 > dissect_spdy_rst_stream_payload(tvb, offset, pinfo, spdy_tree,
-                                              &frame)) {
+                                              &frame, conv_data)) {
         return -1;
       }
       break;
 
     case SPDY_SETTINGS:
       if (0 > dissect_spdy_settings_payload(tvb, offset, pinfo, spdy_tree,
-                                            &frame)) {
+                                            &frame, conv_data)) {
         return -1;
       }
       break;
 
     case SPDY_PING:
       if (0 > dissect_spdy_ping_payload(tvb, offset, pinfo, spdy_tree,
-                                        &frame)) {
+                                        &frame, conv_data)) {
         return -1;
       }
       break;
 
     case SPDY_GOAWAY:
       if (0 > dissect_spdy_goaway_payload(tvb, offset, pinfo, spdy_tree,
-                                          &frame)) {
+                                          &frame, conv_data)) {
         return -1;
       }
       break;
 
     case SPDY_WINDOW_UPDATE:
       if (0 > dissect_spdy_window_update_payload(tvb, offset, pinfo, spdy_tree,
-                                                 &frame)) {
+                                                 &frame, conv_data)) {
         return -1;
       }
       break;
@@ -1990,6 +5125,27 @@ int dissect_spdy_frame(tvbuff_t *tvb,
       break;
   }
 
+  switch (frame.type) {
+    case SPDY_SYN_STREAM:
+    case SPDY_SYN_REPLY:
+    case SPDY_HEADERS:
+    case SPDY_RST_STREAM:
+    case SPDY_WINDOW_UPDATE:
+      stream_id = get_spdy_stream_id(tvb, offset);
+      spdy_add_stream_index(spdy_tree, tvb,
+                            spdy_index_stream_frame(pinfo, conv_data,
+                                                    stream_id),
+                            tap_info);
+      break;
+    default:
+      break;
+  }
+  if (tap_info != NULL) {
+    spdy_tap_frame_info(tap_info, spdy_get_frame_info(tvb, pinfo, offset));
+    tap_info->stream_id = stream_id;
+    tap_queue_packet(spdy_tap, pinfo, tap_info);
+  }
+
   /* Assume that we've consumed the whole frame. */
   return 8 + frame.length;
 }
@@ -1999,8 +5155,79 @@ static guint get_spdy_message_len(packet_info *UNUSED(pinfo), tvbuff_t *tvb,
   return (guint)tvb_get_ntoh24(tvb, offset + 5) + 8;
 }
 
+/*
+ * Dissects the bytes of a DATA frame's payload that a segment starts
+ * with, when the frame's header was in an earlier segment. Returns the
+ * number of bytes dissected.
+ */
+static int dissect_spdy_data_continuation(tvbuff_t *tvb,
+                                          packet_info *pinfo,
+                                          proto_tree *tree,
+                                          spdy_conv_t *conv_data,
+                                          const spdy_partial_data_t *partial) {
+  spdy_control_frame_info_t frame;
+  proto_tree *spdy_tree = NULL;
+  proto_item *spdy_proto = NULL;
+  spdy_tap_info_t *tap_info = NULL;
+  guint32 chunk_length = MIN(partial->remaining,
+                             (guint)tvb_length_remaining(tvb, 0));
+  int dissected_len;
+
+  frame.control_bit = FALSE;
+  frame.version = 0;
+  frame.type = SPDY_DATA;
+  frame.flags = partial->flags;
+  frame.length = partial->length;
+
+  if (tree) {
+    proto_item *ti;
+
+    spdy_proto = proto_tree_add_item(tree, proto_spdy, tvb, 0, chunk_length,
+                                     ENC_NA);
+    spdy_tree = proto_item_add_subtree(spdy_proto, ett_spdy);
+    proto_item_append_text(spdy_proto,
+                           ", DATA, Stream: %u (continued, bytes %u-%u of %u)",
+                           partial->stream_id,
+                           partial->length - partial->remaining + 1,
+                           partial->length - partial->remaining + chunk_length,
+                           partial->length);
+    ti = proto_tree_add_uint(spdy_tree, hf_spdy_streamid, tvb, 0, 0,
+                             partial->stream_id);
+    PROTO_ITEM_SET_GENERATED(ti);
+  }
+  dissected_len = dissect_spdy_data_payload(tvb, 0, pinfo, tree, spdy_tree,
+                                            spdy_proto, conv_data,
+                                            partial->stream_id, &frame,
+                                            chunk_length, FALSE,
+                                            chunk_length == partial->remaining);
+
+  if (have_tap_listener(spdy_tap)) {
+    tap_info = ep_alloc0(sizeof(spdy_tap_info_t));
+    tap_info->type = SPDY_DATA;
+    tap_info->flags = partial->flags;
+    tap_info->continued = TRUE;
+    tap_info->stream_id = partial->stream_id;
+    tap_info->length = partial->length;
+    tap_info->direction = conv_data->direction;
+    tap_info->payload = tvb_get_ptr(tvb, 0, chunk_length);
+    tap_info->payload_len = chunk_length;
+  }
+  spdy_add_stream_index(spdy_tree, tvb,
+                        spdy_index_stream_frame(pinfo, conv_data,
+                                                partial->stream_id),
+                        tap_info);
+  if (tap_info != NULL) {
+    tap_queue_packet(spdy_tap, pinfo, tap_info);
+  }
+  return dissected_len;
+}
+
 /*
  * Wrapper for dissect_spdy_frame, sets fencing and desegments as necessary.
+ *
+ * DATA frames aren't desegmented: their payloads are dissected a segment
+ * at a time, so that TCP doesn't have to buffer up a whole frame, which
+ * can be as large as 16 MB, before any of it is seen.
  */
 static int dissect_spdy(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree) {
   spdy_conv_t *conv_data = NULL;
@@ -2008,6 +5235,32 @@ static int dissect_spdy(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree) {
   int expected_frame_len = 0;
   int dissected_len = 0;
   int remaining_len = tvb_length_remaining(tvb, offset);
+  gboolean want_info_fence = spdy_info_wanted(pinfo);
+  const spdy_partial_data_t *partial;
+
+  /*
+   * Every frame in the buffer belongs to the same conversation and was
+   * sent the same way, so look those up once for all of them.
+   */
+  conv_data = get_or_create_spdy_conversation_data(pinfo);
+  conv_data->direction = spdy_get_direction(conv_data, pinfo);
+  col_set_str(pinfo->cinfo, COL_PROTOCOL, "SPDY");
+
+  /* Finish off any DATA frame begun in an earlier segment. */
+  partial = spdy_get_data_continuation(tvb, pinfo, conv_data);
+  if (partial != NULL) {
+    dissected_len = dissect_spdy_data_continuation(tvb, pinfo, tree,
+                                                   conv_data, partial);
+    if (!pinfo->fd->flags.visited) {
+      conv_data->partial_data[spdy_segment_side(pinfo)].remaining -=
+          dissected_len;
+    }
+    offset += dissected_len;
+    remaining_len = tvb_length_remaining(tvb, offset);
+    if (want_info_fence) {
+      col_set_fence(pinfo->cinfo, COL_INFO);
+    }
+  }
 
   /* Loop over the buffer. */
   while (remaining_len > 0) {
@@ -2018,16 +5271,34 @@ static int dissect_spdy(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree) {
       return offset;
     }
 
-    /* Make sure that we have enough data for the next whole frame. */
+    /*
+     * Make sure that we have enough data for the next whole frame, unless
+     * it's a DATA frame, which can be taken as it comes.
+     */
     expected_frame_len = get_spdy_message_len(pinfo, tvb, offset);
     if (expected_frame_len > remaining_len) {
+      if ((tvb_get_guint8(tvb, offset) & 0x80) == 0 &&
+          tvb_reported_length_remaining(tvb, offset) == remaining_len) {
+        dissected_len = dissect_spdy_frame(tvb, offset, pinfo, tree,
+                                           conv_data);
+        if (dissected_len == remaining_len && !pinfo->fd->flags.visited) {
+          spdy_partial_data_t *side_partial =
+              &conv_data->partial_data[spdy_segment_side(pinfo)];
+
+          side_partial->stream_id = get_spdy_stream_id(tvb, offset);
+          side_partial->flags = tvb_get_guint8(tvb, offset + 4);
+          side_partial->length = expected_frame_len - 8;
+          side_partial->remaining = expected_frame_len - remaining_len;
+        }
+        return dissected_len == remaining_len ? offset + dissected_len
+                                              : offset;
+      }
       pinfo->desegment_offset = offset;
       pinfo->desegment_len = expected_frame_len - remaining_len;
       return offset;
     }
 
     /* Dissect the frame. */
-    conv_data = get_or_create_spdy_conversation_data(pinfo);
     dissected_len = dissect_spdy_frame(tvb, offset, pinfo, tree, conv_data);
     if (dissected_len != expected_frame_len) {
       if (spdy_debug) {
@@ -2039,11 +5310,13 @@ static int dissect_spdy(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree) {
     remaining_len = tvb_length_remaining(tvb, offset);
 
     /*
-     * OK, we've set the Protocol and Info columns for the
-     * first SPDY message; set a fence so that subsequent
-     * SPDY messages don't overwrite the Info column.
+     * OK, we've set the Info column for this SPDY message;
+     * set a fence so that subsequent SPDY messages don't
+     * overwrite it.
      */
-    col_set_fence(pinfo->cinfo, COL_INFO);
+    if (want_info_fence) {
+      col_set_fence(pinfo->cinfo, COL_INFO);
+    }
   }
 
   /* Return the number of bytes processed. */
@@ -2051,14 +5324,22 @@ static int dissect_spdy(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree) {
 }
 
 /*
- * Looks for SPDY frame at tvb start.
- * If not enough data for either, requests more via desegment struct.
+ * Checks, without allocating anything, whether a tvb starts with a
+ * plausible SPDY frame header: a supported version, a known control frame
+ * type with only its defined flags and a length that fits it, or a DATA
+ * frame for a nonzero stream with no flags other than FIN.
  */
-static gboolean dissect_spdy_heur(tvbuff_t *tvb,
-                                  packet_info *pinfo,
-                                  proto_tree *tree) {
-  int old_desegment_offset = pinfo->desegment_offset;
-  int old_desegment_len = pinfo->desegment_len;
+static gboolean spdy_looks_like_frame_header(tvbuff_t *tvb) {
+  guint8 first_byte;
+  guint8 flags;
+  guint32 length;
+
+  if (tvb_length(tvb) < 8) {
+    return FALSE;
+  }
+  first_byte = tvb_get_guint8(tvb, 0);
+  flags = tvb_get_guint8(tvb, 4);
+  length = tvb_get_ntoh24(tvb, 5);
 
   /*
    * The first byte of a SPDY frame must be either 0 or
@@ -2068,13 +5349,81 @@ static gboolean dissect_spdy_heur(tvbuff_t *tvb,
    * byte, but this is a pretty reliable heuristic for
    * now.)
    */
-  guint8 first_byte = tvb_get_guint8(tvb, 0);
-  if (first_byte != 0x80 && first_byte != 0x0) {
+  if (first_byte == 0x80) {
+    guint16 version = tvb_get_ntohs(tvb, 0) & 0x7fff;
+
+    if (version < MIN_SPDY_VERSION || version > MAX_SPDY_VERSION) {
+      return FALSE;
+    }
+    switch (tvb_get_ntohs(tvb, 2)) {
+      case SPDY_SYN_STREAM:
+        return (flags & ~(SPDY_FLAG_FIN | SPDY_FLAG_UNIDIRECTIONAL)) == 0 &&
+            length >= 10;
+      case SPDY_SYN_REPLY:
+      case SPDY_HEADERS:
+        return (flags & ~SPDY_FLAG_FIN) == 0 && length >= 4;
+      case SPDY_SETTINGS:
+        return (flags & ~SPDY_FLAG_SETTINGS_CLEAR_SETTINGS) == 0 &&
+            length >= 4;
+      case SPDY_RST_STREAM:
+      case SPDY_GOAWAY:
+      case SPDY_WINDOW_UPDATE:
+        return flags == 0 && length == 8;
+      case SPDY_PING:
+        return flags == 0 && length == 4;
+      case SPDY_CREDENTIAL:
+        return flags == 0;
+      default:
+        return FALSE;
+    }
+  }
+  return first_byte == 0x0 && tvb_get_ntohl(tvb, 0) != 0 &&
+      (flags & ~SPDY_FLAG_FIN) == 0;
+}
+
+/*
+ * Looks for SPDY frame at tvb start.
+ * If not enough data for either, requests more via desegment struct.
+ */
+static gboolean dissect_spdy_heur(tvbuff_t *tvb,
+                                  packet_info *pinfo,
+                                  proto_tree *tree) {
+  int old_desegment_offset = pinfo->desegment_offset;
+  int old_desegment_len = pinfo->desegment_len;
+  conversation_t *conversation;
+
+  /* Fail fast on conversations already found not to be SPDY. */
+  conversation = find_conversation(pinfo->fd->num,
+                                   &pinfo->src,
+                                   &pinfo->dst,
+                                   pinfo->ptype,
+                                   pinfo->srcport,
+                                   pinfo->destport,
+                                   0);
+  if (conversation != NULL &&
+      conversation_get_proto_data(conversation, proto_spdy) ==
+      (void *)spdy_not_spdy) {
+    return FALSE;
+  }
+
+  if (!spdy_looks_like_frame_header(tvb)) {
+    /*
+     * Only a conversation that has never been taken for SPDY is written
+     * off; SPDY conversations get their own dissector below.
+     */
+    if (conversation != NULL && !pinfo->fd->flags.visited &&
+        conversation_get_proto_data(conversation, proto_spdy) == NULL) {
+      conversation_add_proto_data(conversation, proto_spdy,
+                                  (void *)spdy_not_spdy);
+    }
     return FALSE;
   }
 
   /* Attempt dissection. */
   if (dissect_spdy(tvb, pinfo, tree) != 0) {
+    /* Hand the rest of the conversation straight to us. */
+    conversation_set_dissector(find_or_create_conversation(pinfo),
+                               spdy_handle);
     return TRUE;
   }
 
@@ -2085,10 +5434,456 @@ static gboolean dissect_spdy_heur(tvbuff_t *tvb,
   return FALSE;
 }
 
+/*
+ * Frame statistics tree, fed by the spdy tap.
+ */
+static const gchar *st_str_frames = "SPDY Frames";
+static const gchar *st_str_bytes = "SPDY Bytes";
+static const gchar *st_str_frame_headers = "Frame headers";
+static const gchar *st_str_control_payload = "Control frame payload";
+static const gchar *st_str_header_blocks = "Header blocks";
+static const gchar *st_str_data_payload = "DATA payload";
+static const gchar *st_str_header_block_sizes = "SPDY Header Blocks";
+static const gchar *st_str_compressed = "Compressed bytes";
+static const gchar *st_str_uncompressed = "Uncompressed bytes";
+static const gchar *st_str_priority_inversions = "SPDY Priority Inversions";
+static const gchar *st_str_header_compression = "SPDY Header Compression";
+static const gchar *st_str_to_server = "To server";
+static const gchar *st_str_to_client = "To client";
+static const gchar *st_str_unknown_direction = "Unknown direction";
+static const gchar *st_str_push = "SPDY Server Push";
+static const gchar *st_str_push_useful = "Useful bytes";
+static const gchar *st_str_push_wasted = "Wasted bytes";
+static const gchar *st_str_bytes_ahead = "Lower-priority bytes sent ahead";
+
+static int st_node_frames = -1;
+static int st_node_bytes = -1;
+static int st_node_control_payload = -1;
+static int st_node_header_block_sizes = -1;
+static int st_node_priority_inversions = -1;
+static int st_node_header_compression = -1;
+static int st_node_push = -1;
+
+static void spdy_stats_tree_init(stats_tree *st) {
+  st_node_frames = stats_tree_create_node(st, st_str_frames, 0, TRUE);
+  st_node_bytes = stats_tree_create_node(st, st_str_bytes, 0, TRUE);
+  stats_tree_create_node(st, st_str_frame_headers, st_node_bytes, FALSE);
+  st_node_control_payload = stats_tree_create_node(st, st_str_control_payload,
+                                                   st_node_bytes, TRUE);
+  stats_tree_create_node(st, st_str_data_payload, st_node_bytes, FALSE);
+  st_node_header_block_sizes = stats_tree_create_node(
+      st, st_str_header_block_sizes, 0, TRUE);
+  st_node_priority_inversions = stats_tree_create_node(
+      st, st_str_priority_inversions, 0, TRUE);
+  st_node_header_compression = stats_tree_create_node(
+      st, st_str_header_compression, 0, TRUE);
+  st_node_push = stats_tree_create_node(st, st_str_push, 0, TRUE);
+}
+
+/*
+ * Names a frame's connection, client first, for the statistics tree.
+ */
+static const gchar *spdy_stats_conversation_name(packet_info *pinfo,
+                                                 spdy_direction_t direction) {
+  if (direction == SPDY_DIRECTION_TO_CLIENT) {
+    return ep_strdup_printf("%s:%u <-> %s:%u",
+                            ep_address_to_str(&pinfo->dst), pinfo->destport,
+                            ep_address_to_str(&pinfo->src), pinfo->srcport);
+  }
+  return ep_strdup_printf("%s:%u <-> %s:%u",
+                          ep_address_to_str(&pinfo->src), pinfo->srcport,
+                          ep_address_to_str(&pinfo->dst), pinfo->destport);
+}
+
+static int spdy_stats_tree_packet(stats_tree *st,
+                                  packet_info *pinfo,
+                                  epan_dissect_t *edt _U_,
+                                  const void *p) {
+  const spdy_tap_info_t *tap_info = p;
+
+  if (tap_info->continued) {
+    /* The frame was counted when its header went by. */
+    return 0;
+  }
+  tick_stat_node(st, st_str_frames, 0, FALSE);
+  tick_stat_node(st, val_to_str(tap_info->type, frame_type_names,
+                                "Unknown(%d)"),
+                 st_node_frames, FALSE);
+
+  increase_stat_node(st, st_str_bytes, 0, FALSE, 8 + tap_info->length);
+  increase_stat_node(st, st_str_frame_headers, st_node_bytes, FALSE, 8);
+  if (tap_info->type == SPDY_DATA) {
+    increase_stat_node(st, st_str_data_payload, st_node_bytes, FALSE,
+                       tap_info->length);
+  } else {
+    increase_stat_node(st, st_str_control_payload, st_node_bytes, FALSE,
+                       tap_info->length);
+    if (tap_info->header_block_len != 0) {
+      increase_stat_node(st, st_str_header_blocks, st_node_control_payload,
+                         FALSE, tap_info->header_block_len);
+      tick_stat_node(st, st_str_header_block_sizes, 0, FALSE);
+      increase_stat_node(st, st_str_compressed, st_node_header_block_sizes,
+                         FALSE, tap_info->header_block_len);
+      increase_stat_node(st, st_str_uncompressed, st_node_header_block_sizes,
+                         FALSE, tap_info->header_block_uncomp_len);
+    }
+    if (tap_info->header_block_uncomp_len != 0) {
+      int conv_node;
+      int dir_node;
+      const gchar *dir_name;
+
+      switch (tap_info->direction) {
+        case SPDY_DIRECTION_TO_SERVER:
+          dir_name = st_str_to_server;
+          break;
+        case SPDY_DIRECTION_TO_CLIENT:
+          dir_name = st_str_to_client;
+          break;
+        default:
+          dir_name = st_str_unknown_direction;
+          break;
+      }
+      tick_stat_node(st, st_str_header_compression, 0, FALSE);
+      conv_node = tick_stat_node(st,
+                                 spdy_stats_conversation_name(
+                                     pinfo, tap_info->direction),
+                                 st_node_header_compression, TRUE);
+      dir_node = tick_stat_node(st, dir_name, conv_node, TRUE);
+      increase_stat_node(st, st_str_compressed, dir_node, FALSE,
+                         tap_info->header_block_len);
+      increase_stat_node(st, st_str_uncompressed, dir_node, FALSE,
+                         tap_info->header_block_uncomp_len);
+    }
+  }
+  if (tap_info->bytes_ahead != 0) {
+    int conv_node;
+
+    tick_stat_node(st, st_str_priority_inversions, 0, FALSE);
+    conv_node = tick_stat_node(st,
+                               spdy_stats_conversation_name(
+                                   pinfo, tap_info->direction),
+                               st_node_priority_inversions, TRUE);
+    increase_stat_node(st, st_str_bytes_ahead, conv_node, FALSE,
+                       tap_info->bytes_ahead);
+  }
+  if (tap_info->push_outcome != SPDY_PUSH_PENDING) {
+    int conv_node;
+
+    /* Pushed streams, by how they ended, and their bytes. */
+    tick_stat_node(st, st_str_push, 0, FALSE);
+    conv_node = tick_stat_node(st,
+                               spdy_stats_conversation_name(
+                                   pinfo, tap_info->direction),
+                               st_node_push, TRUE);
+    tick_stat_node(st, val_to_str(tap_info->push_outcome, push_outcome_names,
+                                  "Unknown(%d)"),
+                   conv_node, FALSE);
+    increase_stat_node(st,
+                       tap_info->push_outcome == SPDY_PUSH_COMPLETED ?
+                       st_str_push_useful : st_str_push_wasted,
+                       conv_node, FALSE, (gint)MIN(tap_info->pushed_bytes,
+                                                   G_MAXINT));
+  }
+  return 1;
+}
+
+/*
+ * Nothing to do per packet for -z spdy,perf; the counters are kept by the
+ * dissector itself.
+ */
+static int spdy_perf_packet(void *tapdata _U_, packet_info *pinfo _U_,
+                            epan_dissect_t *edt _U_,
+                            const void *data _U_) {
+  return 0;
+}
+
+static void spdy_perf_print_inflate(const char *name,
+                                    const spdy_inflate_counters_t *counters) {
+  printf("%-26s %12" G_GINT64_MODIFIER "u calls %14" G_GINT64_MODIFIER
+         "u bytes %10.3f s\n",
+         name, counters->calls, counters->bytes, counters->seconds);
+}
+
+static void spdy_perf_draw(void *tapdata) {
+  const spdy_perf_counters_t *perf = tapdata;
+
+  printf("\n");
+  printf("===================================================================\n");
+  printf("SPDY Performance Counters\n");
+  printf("===================================================================\n");
+  spdy_perf_print_inflate("Header block inflate", &perf->header_inflate);
+  spdy_perf_print_inflate("Entity body inflate", &perf->body_inflate);
+  printf("%-26s %12" G_GINT64_MODIFIER "u       %14" G_GINT64_MODIFIER
+         "u bytes\n", "Header blocks cached",
+         perf->header_blocks_cached, perf->header_bytes_cached);
+  printf("%-26s %12" G_GINT64_MODIFIER "u\n", "Header blocks from cache",
+         perf->header_blocks_from_cache);
+  printf("%-26s %12" G_GINT64_MODIFIER "u now   %14" G_GINT64_MODIFIER
+         "u peak\n", "Body bytes retained",
+         spdy_retained_body_bytes, perf->retained_bytes_peak);
+  printf("%-26s %12" G_GINT64_MODIFIER "u total\n", "Conversations",
+         perf->conversations);
+  printf("%-26s %12u now   %14u peak\n", "  with header inflaters",
+         perf->conversations_inflating, perf->conversations_inflating_peak);
+  printf("%-26s %12" G_GINT64_MODIFIER "u total\n", "Streams",
+         perf->streams);
+  printf("%-26s %12u now   %14u peak\n", "  live",
+         perf->streams_live, perf->streams_live_peak);
+  printf("===================================================================\n");
+}
+
+/*
+ * Sets up -z spdy,perf.
+ */
+static void spdy_perf_init(const char *optarg _U_, void *userdata _U_) {
+  GString *error_string;
+
+  error_string = register_tap_listener("spdy", &spdy_perf, NULL, 0, NULL,
+                                       spdy_perf_packet, spdy_perf_draw);
+  if (error_string != NULL) {
+    fprintf(stderr, "Couldn't register spdy,perf tap: %s\n",
+            error_string->str);
+    g_string_free(error_string, TRUE);
+    return;
+  }
+  if (spdy_perf_timer == NULL) {
+    spdy_perf_timer = g_timer_new();
+  }
+}
+
+/* State for -z follow,spdy,<stream index>. */
+typedef struct _spdy_follow_t {
+  guint32 stream_index;
+  guint32 stream_id;
+  const GArray *frames;
+  GString *text;
+} spdy_follow_t;
+
+/*
+ * Appends the name/value pairs of an uncompressed header block, one per
+ * line. Multiple values for a name (NUL-separated) each get their own.
+ */
+static void spdy_follow_append_headers(GString *text, const guint8 *block,
+                                       guint32 len) {
+  spdy_header_iter_t headers;
+
+  if (block == NULL || !spdy_header_iter_init(&headers, block, len)) {
+    return;
+  }
+  while (spdy_header_iter_next(&headers) == SPDY_HEADER_PAIR) {
+    const guint8 *value = headers.value;
+    guint32 value_len = headers.value_length;
+    guint32 start = 0;
+    guint32 i;
+
+    for (i = 0; i <= value_len; i++) {
+      if (i == value_len || value[i] == '\0') {
+        g_string_append_printf(text, "%.*s: %.*s\n",
+                               (int)headers.name_length, headers.name,
+                               (int)(i - start), value + start);
+        start = i + 1;
+      }
+    }
+  }
+}
+
+/*
+ * Appends DATA payload bytes, with anything unprintable shown as '.'.
+ */
+static void spdy_follow_append_data(GString *text, const guint8 *data,
+                                    guint32 len) {
+  guint32 i;
+
+  for (i = 0; i < len; i++) {
+    guint8 c = data[i];
+
+    g_string_append_c(text,
+                      (isprint(c) || c == '\n' || c == '\t') ? c : '.');
+  }
+  if (len != 0 && data[len - 1] != '\n') {
+    g_string_append_c(text, '\n');
+  }
+}
+
+static int spdy_follow_packet(void *tapdata, packet_info *pinfo,
+                              epan_dissect_t *edt _U_, const void *data) {
+  spdy_follow_t *follow = tapdata;
+  const spdy_tap_info_t *tap_info = data;
+
+  if (!tap_info->has_stream_index ||
+      tap_info->stream_index != follow->stream_index) {
+    return 0;
+  }
+  follow->stream_id = tap_info->stream_id;
+  follow->frames = tap_info->stream_frames;
+
+  g_string_append_printf(follow->text, "\n[Frame %u] %s%s%s",
+                         pinfo->fd->num,
+                         val_to_str(tap_info->type, frame_type_names,
+                                    "Unknown(%d)"),
+                         tap_info->continued ? " (continued)" : "",
+                         (tap_info->flags & SPDY_FLAG_FIN) ? " FIN" : "");
+  switch (tap_info->direction) {
+    case SPDY_DIRECTION_TO_SERVER:
+      g_string_append(follow->text, ", client to server");
+      break;
+    case SPDY_DIRECTION_TO_CLIENT:
+      g_string_append(follow->text, ", server to client");
+      break;
+    default:
+      break;
+  }
+  g_string_append_c(follow->text, '\n');
+
+  switch (tap_info->type) {
+    case SPDY_SYN_STREAM:
+    case SPDY_SYN_REPLY:
+    case SPDY_HEADERS:
+      spdy_follow_append_headers(follow->text, tap_info->payload,
+                                 tap_info->payload_len);
+      break;
+    case SPDY_DATA:
+      spdy_follow_append_data(follow->text, tap_info->payload,
+                              tap_info->payload_len);
+      break;
+    default:
+      break;
+  }
+  return 0;
+}
+
+static void spdy_follow_draw(void *tapdata) {
+  spdy_follow_t *follow = tapdata;
+  guint i;
+
+  printf("\n");
+  printf("===================================================================\n");
+  printf("Follow: spdy,%u\n", follow->stream_index);
+  if (follow->frames == NULL) {
+    printf("No such stream\n");
+  } else {
+    printf("SPDY stream ID: %u\n", follow->stream_id);
+    printf("Frames:");
+    for (i = 0; i < follow->frames->len; i++) {
+      printf(" %u", g_array_index(follow->frames, guint32, i));
+    }
+    printf("\n");
+    fputs(follow->text->str, stdout);
+  }
+  printf("===================================================================\n");
+}
+
+/*
+ * Sets up -z follow,spdy,<stream index>, which prints the headers and
+ * bodies of one stream, as numbered by spdy.stream_index.
+ *
+ * This is no faster than filtering on the stream: tshark still reads and
+ * dissects every frame, and the stream index only lists the frames to
+ * report. A dissector has no way to make tshark skip frames.
+ */
+static void spdy_follow_init(const char *optarg, void *userdata _U_) {
+  spdy_follow_t *follow;
+  GString *error_string;
+  guint32 stream_index;
+  char *end;
+
+  if (strncmp(optarg, "follow,spdy,", 12) != 0) {
+    fprintf(stderr, "Usage: -z follow,spdy,<stream index>\n");
+    return;
+  }
+  stream_index = (guint32)strtoul(optarg + 12, &end, 10);
+  if (optarg[12] == '\0' || *end != '\0') {
+    fprintf(stderr, "Usage: -z follow,spdy,<stream index>\n");
+    return;
+  }
+
+  follow = g_malloc0(sizeof(spdy_follow_t));
+  follow->stream_index = stream_index;
+  follow->text = g_string_new("");
+  error_string = register_tap_listener("spdy", follow, NULL, 0, NULL,
+                                       spdy_follow_packet, spdy_follow_draw);
+  if (error_string != NULL) {
+    fprintf(stderr, "Couldn't register follow,spdy tap: %s\n",
+            error_string->str);
+    g_string_free(error_string, TRUE);
+    g_string_free(follow->text, TRUE);
+    g_free(follow);
+  }
+}
+
 /*
  * Called when the plugin will be working on a completely new capture.
  */
 static void reinit_spdy(void) {
+  GSList *convlist;
+
+  /*
+   * Everything here is g_malloc'ed: se_alloc'ed memory has already been
+   * freed by the time the init routines run.
+   */
+  for (convlist = spdy_conversations; convlist != NULL;
+       convlist = g_slist_next(convlist)) {
+    spdy_conv_t *conv_data = convlist->data;
+    spdy_release_decompressors(conv_data);
+    g_hash_table_destroy(conv_data->streams);
+    g_hash_table_destroy(conv_data->pings);
+    g_hash_table_destroy(conv_data->stream_frames);
+    spdy_free_inflate_buf(&conv_data->inflate_buf);
+    g_free(conv_data);
+  }
+  g_slist_free(spdy_conversations);
+  spdy_conversations = NULL;
+  spdy_header_cache_close();
+
+  /* The streams are gone, so nothing holds on to a body's ID any more. */
+  if (spdy_bodies != NULL) {
+    g_hash_table_destroy(spdy_bodies);
+  }
+  spdy_bodies = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                      NULL, spdy_free_body);
+  spdy_body_count = 0;
+  spdy_retained_body_bytes = 0;
+
+  for (convlist = spdy_spool_files; convlist != NULL;
+       convlist = g_slist_next(convlist)) {
+    ws_unlink(convlist->data);
+    g_free(convlist->data);
+  }
+  g_slist_free(spdy_spool_files);
+  spdy_spool_files = NULL;
+
+  if (spdy_frame_infos != NULL) {
+    g_hash_table_destroy(spdy_frame_infos);
+  }
+  spdy_frame_infos = g_hash_table_new(spdy_frame_key_hash,
+                                      spdy_frame_key_equal);
+
+  if (spdy_data_continuations != NULL) {
+    g_hash_table_destroy(spdy_data_continuations);
+  }
+  spdy_data_continuations = g_hash_table_new(spdy_frame_key_hash,
+                                             spdy_frame_key_equal);
+
+  if (spdy_media_handles != NULL) {
+    g_hash_table_destroy(spdy_media_handles);
+  }
+  spdy_media_handles = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+  /* Everything that points into the string pool is gone by now. */
+  if (spdy_content_types != NULL) {
+    g_hash_table_destroy(spdy_content_types);
+  }
+  spdy_content_types = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                             g_free, g_free);
+  if (spdy_string_pool != NULL) {
+    g_hash_table_destroy(spdy_string_pool);
+  }
+  spdy_string_pool = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                           g_free, NULL);
+
+  spdy_stream_count = 0;
+
+  memset(&spdy_perf, 0, sizeof(spdy_perf));
 }
 
 /* NMAKE complains about flags_set_truth not being constant. Duplicate
@@ -2178,6 +5973,55 @@ void proto_register_spdy(void) {
           "", HFILL
       }
     },
+    { &hf_spdy_header_block_comp_len,
+      { "Compressed size", "spdy.header_block.compressed",
+          FT_UINT32, BASE_DEC, NULL, 0x0,
+          "Size of the header block as sent", HFILL
+      }
+    },
+    { &hf_spdy_header_block_uncomp_len,
+      { "Uncompressed size", "spdy.header_block.uncompressed",
+          FT_UINT32, BASE_DEC, NULL, 0x0,
+          "Size of the header block once inflated", HFILL
+      }
+    },
+    { &hf_spdy_header_block_ratio,
+      { "Compression ratio", "spdy.header_block.ratio",
+          FT_DOUBLE, BASE_NONE, NULL, 0x0,
+          "Uncompressed size over compressed size", HFILL
+      }
+    },
+    { &hf_spdy_dir_header_comp,
+      { "Compressed bytes this direction",
+        "spdy.header_block.direction_compressed",
+          FT_UINT64, BASE_DEC, NULL, 0x0,
+          "Header block bytes sent this way on the connection so far",
+          HFILL
+      }
+    },
+    { &hf_spdy_dir_header_uncomp,
+      { "Uncompressed bytes this direction",
+        "spdy.header_block.direction_uncompressed",
+          FT_UINT64, BASE_DEC, NULL, 0x0,
+          "Inflated size of the header blocks sent this way on the "
+          "connection so far", HFILL
+      }
+    },
+    { &hf_spdy_conv_header_comp,
+      { "Compressed bytes on connection",
+        "spdy.header_block.conv_compressed",
+          FT_UINT64, BASE_DEC, NULL, 0x0,
+          "Header block bytes sent on the connection so far", HFILL
+      }
+    },
+    { &hf_spdy_conv_header_uncomp,
+      { "Uncompressed bytes on connection",
+        "spdy.header_block.conv_uncompressed",
+          FT_UINT64, BASE_DEC, NULL, 0x0,
+          "Inflated size of the header blocks sent on the connection so far",
+          HFILL
+      }
+    },
     { &hf_spdy_header,
       { "Header",         "spdy.header",
         FT_NONE, BASE_NONE, NULL, 0x0,
@@ -2196,6 +6040,114 @@ void proto_register_spdy(void) {
           "", HFILL
       }
     },
+    { &hf_spdy_method,
+      { "Method", "spdy.method",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          ":method header", HFILL
+      }
+    },
+    { &hf_spdy_path,
+      { "Path", "spdy.path",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          ":path header", HFILL
+      }
+    },
+    { &hf_spdy_http_version,
+      { "HTTP version", "spdy.http_version",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          ":version header", HFILL
+      }
+    },
+    { &hf_spdy_host,
+      { "Host", "spdy.host",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          ":host header", HFILL
+      }
+    },
+    { &hf_spdy_scheme,
+      { "Scheme", "spdy.scheme",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          ":scheme header", HFILL
+      }
+    },
+    { &hf_spdy_status,
+      { "Status", "spdy.status",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          ":status header", HFILL
+      }
+    },
+    { &hf_spdy_content_type,
+      { "Content-Type", "spdy.content_type",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          "content-type header", HFILL
+      }
+    },
+    { &hf_spdy_content_encoding,
+      { "Content-Encoding", "spdy.content_encoding",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          "content-encoding header", HFILL
+      }
+    },
+    { &hf_spdy_content_length,
+      { "Content-Length", "spdy.content_length",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          "content-length header", HFILL
+      }
+    },
+    { &hf_spdy_user_agent,
+      { "User-Agent", "spdy.user_agent",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          "user-agent header", HFILL
+      }
+    },
+    { &hf_spdy_accept,
+      { "Accept", "spdy.accept",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          "accept header", HFILL
+      }
+    },
+    { &hf_spdy_accept_encoding,
+      { "Accept-Encoding", "spdy.accept_encoding",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          "accept-encoding header", HFILL
+      }
+    },
+    { &hf_spdy_cookie,
+      { "Cookie", "spdy.cookie",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          "cookie header", HFILL
+      }
+    },
+    { &hf_spdy_set_cookie,
+      { "Set-Cookie", "spdy.set_cookie",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          "set-cookie header", HFILL
+      }
+    },
+    { &hf_spdy_referer,
+      { "Referer", "spdy.referer",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          "referer header", HFILL
+      }
+    },
+    { &hf_spdy_location,
+      { "Location", "spdy.location",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          "location header", HFILL
+      }
+    },
+    { &hf_spdy_server,
+      { "Server", "spdy.server",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          "server header", HFILL
+      }
+    },
+    { &hf_spdy_cache_control,
+      { "Cache-Control", "spdy.cache_control",
+          FT_STRING, BASE_NONE, NULL, 0x0,
+          "cache-control header", HFILL
+      }
+    },
     { &hf_spdy_streamid,
       { "Stream ID",      "spdy.streamid",
           FT_UINT32, BASE_DEC, NULL, 0x0,
@@ -2256,6 +6208,24 @@ void proto_register_spdy(void) {
           NULL, HFILL
       }
     },
+    { &hf_spdy_ping_rtt,
+      { "Round trip time", "spdy.ping.rtt",
+          FT_RELATIVE_TIME, BASE_NONE, NULL, 0x0,
+          "Time between this PING and the one it echoes", HFILL
+      }
+    },
+    { &hf_spdy_ping_response_in,
+      { "Echo in", "spdy.ping.response_in",
+          FT_FRAMENUM, BASE_NONE, NULL, 0x0,
+          "The frame echoing this PING", HFILL
+      }
+    },
+    { &hf_spdy_ping_request_in,
+      { "Echo of", "spdy.ping.request_in",
+          FT_FRAMENUM, BASE_NONE, NULL, 0x0,
+          "The PING this frame echoes", HFILL
+      }
+    },
     { &hf_spdy_goaway_last_good_stream_id,
       { "Last Good Stream ID", "spdy.goaway_last_good_stream_id",
           FT_UINT32, BASE_DEC, NULL, 0x0,
@@ -2274,6 +6244,117 @@ void proto_register_spdy(void) {
           NULL, HFILL
       }
     },
+    { &hf_spdy_window,
+      { "Stream send window", "spdy.window_remaining",
+          FT_INT32, BASE_DEC, NULL, 0x0,
+          "Bytes the sender may still send on this stream", HFILL
+      }
+    },
+    { &hf_spdy_conn_window,
+      { "Connection send window", "spdy.conn_window_remaining",
+          FT_INT32, BASE_DEC, NULL, 0x0,
+          "Bytes the sender may still send on this connection", HFILL
+      }
+    },
+    { &hf_spdy_stream_index,
+      { "Stream index", "spdy.stream_index",
+          FT_UINT32, BASE_DEC, NULL, 0x0,
+          "Number of this stream among all those in the capture", HFILL
+      }
+    },
+    { &hf_spdy_bytes_ahead,
+      { "Lower-priority bytes sent ahead", "spdy.priority_inversion.bytes",
+          FT_UINT32, BASE_DEC, NULL, 0x0,
+          "Lower-priority DATA bytes sent while this stream had data pending",
+          HFILL
+      }
+    },
+    { &hf_spdy_conv_priority_inversions,
+      { "Connection priority inversions", "spdy.priority_inversion.conv_count",
+          FT_UINT32, BASE_DEC, NULL, 0x0,
+          "DATA frames on this connection so far that lower-priority DATA "
+          "went ahead of", HFILL
+      }
+    },
+    { &hf_spdy_conv_bytes_ahead,
+      { "Connection lower-priority bytes sent ahead",
+        "spdy.priority_inversion.conv_bytes",
+          FT_UINT64, BASE_DEC, NULL, 0x0,
+          "Lower-priority DATA bytes sent ahead of pending higher-priority "
+          "DATA on this connection so far", HFILL
+      }
+    },
+    { &hf_spdy_concurrent_streams,
+      { "Concurrent streams", "spdy.concurrent_streams",
+          FT_UINT32, BASE_DEC, NULL, 0x0,
+          "Streams the stream's opener has open once this frame is sent",
+          HFILL
+      }
+    },
+    { &hf_spdy_concurrency_limit,
+      { "Peer's concurrent stream limit", "spdy.max_concurrent_streams",
+          FT_UINT32, BASE_DEC, NULL, 0x0,
+          "MAX_CONCURRENT_STREAMS setting of the stream opener's peer",
+          HFILL
+      }
+    },
+    { &hf_spdy_push_parent_frame,
+      { "Pushed for stream opened in", "spdy.push.parent_in",
+          FT_FRAMENUM, BASE_NONE, NULL, 0x0,
+          "The SYN_STREAM of the stream this one was pushed for", HFILL
+      }
+    },
+    { &hf_spdy_push_outcome,
+      { "Push outcome", "spdy.push.outcome",
+          FT_UINT8, BASE_DEC, VALS(push_outcome_names), 0x0,
+          "How this pushed stream ended", HFILL
+      }
+    },
+    { &hf_spdy_pushed_bytes,
+      { "Bytes pushed", "spdy.push.bytes",
+          FT_UINT64, BASE_DEC, NULL, 0x0,
+          "DATA payload bytes the server sent on this pushed stream", HFILL
+      }
+    },
+    { &hf_spdy_conv_push_useful,
+      { "Connection useful pushed bytes", "spdy.push.conv_useful_bytes",
+          FT_UINT64, BASE_DEC, NULL, 0x0,
+          "Bytes of pushed streams completed on this connection so far",
+          HFILL
+      }
+    },
+    { &hf_spdy_conv_push_wasted,
+      { "Connection wasted pushed bytes", "spdy.push.conv_wasted_bytes",
+          FT_UINT64, BASE_DEC, NULL, 0x0,
+          "Bytes of pushed streams reset on this connection so far", HFILL
+      }
+    },
+    { &hf_spdy_syn_stream_in,
+      { "SYN_STREAM in", "spdy.syn_stream_in",
+          FT_FRAMENUM, BASE_NONE, NULL, 0x0,
+          "The frame that opened this stream", HFILL
+      }
+    },
+    { &hf_spdy_time_to_reply,
+      { "Time to reply", "spdy.time_to_reply",
+          FT_RELATIVE_TIME, BASE_NONE, NULL, 0x0,
+          "Time from the SYN_STREAM to the SYN_REPLY", HFILL
+      }
+    },
+    { &hf_spdy_time_to_first_byte,
+      { "Time to first byte", "spdy.time_to_first_byte",
+          FT_RELATIVE_TIME, BASE_NONE, NULL, 0x0,
+          "Time from the SYN_STREAM to the first DATA frame of the response",
+          HFILL
+      }
+    },
+    { &hf_spdy_stream_duration,
+      { "Stream duration", "spdy.stream_duration",
+          FT_RELATIVE_TIME, BASE_NONE, NULL, 0x0,
+          "Time from the SYN_STREAM until both sides had finished sending",
+          HFILL
+      }
+    },
   };
   static gint *ett[] = {
     &ett_spdy,
@@ -2281,16 +6362,48 @@ void proto_register_spdy(void) {
     &ett_spdy_header_block,
     &ett_spdy_header,
     &ett_spdy_setting,
+    &ett_spdy_effective_settings,
     &ett_spdy_encoded_entity,
   };
 
   module_t *spdy_module;
+  uat_t *headers_uat;
+  static uat_field_t custom_header_uat_fields[] = {
+    UAT_FLD_CSTRING(header_fields, header_name, "Header name",
+                    "SPDY header name"),
+    UAT_FLD_CSTRING(header_fields, header_desc, "Field desc",
+                    "Description of the value contained in the header"),
+    UAT_END_FIELDS
+  };
 
   proto_spdy = proto_register_protocol("SPDY", "SPDY", "spdy");
   proto_register_field_array(proto_spdy, hf, array_length(hf));
   proto_register_subtree_array(ett, array_length(ett));
   new_register_dissector("spdy", dissect_spdy, proto_spdy);
-  spdy_module = prefs_register_protocol(proto_spdy, reinit_spdy);
+  register_init_routine(&reinit_spdy);
+  register_postseq_cleanup_routine(reset_decompressors);
+
+  spdy_module = prefs_register_protocol(proto_spdy, NULL);
+
+  headers_uat = uat_new("Custom SPDY header fields",
+                        sizeof(header_field_t),
+                        "custom_spdy_header_fields",
+                        TRUE,
+                        (void **)&header_fields,
+                        &num_header_fields,
+                        UAT_CAT_FIELDS,
+                        NULL,
+                        header_fields_copy_cb,
+                        header_fields_update_cb,
+                        header_fields_free_cb,
+                        header_fields_post_update_cb,
+                        custom_header_uat_fields);
+  prefs_register_uat_preference(spdy_module, "custom_spdy_header_fields",
+                                "Custom SPDY header fields",
+                                "A table to define custom SPDY headers for "
+                                "which fields can be set up and used for "
+                                "filtering",
+                                headers_uat);
   prefs_register_bool_preference(spdy_module, "assemble_data_frames",
                                  "Assemble SPDY bodies that consist of multiple DATA frames",
                                  "Whether the SPDY dissector should reassemble multiple "
@@ -2306,11 +6419,64 @@ void proto_register_spdy(void) {
                                  "Whether to uncompress entity bodies that are compressed "
                                  "using \"Content-Encoding: \"",
                                  &spdy_decompress_body);
+  prefs_register_string_preference(spdy_module, "header_cache_dir",
+                                   "Header block cache directory",
+                                   "A directory in which to keep uncompressed "
+                                   "header blocks, so that a capture that is "
+                                   "opened again needn't inflate them again. "
+                                   "Leave empty to not keep them.",
+                                   &spdy_header_cache_dir);
 #endif
+  prefs_register_uint_preference(spdy_module, "max_body_memory",
+                                 "Maximum memory for entity bodies (KB)",
+                                 "Upper bound on the entity body data kept "
+                                 "in memory, both for bodies still being "
+                                 "received and for finished ones, which are "
+                                 "kept so their frames can be shown again. "
+                                 "When exceeded, the oldest bodies are "
+                                 "dropped. 0 means no limit.",
+                                 10, &spdy_max_body_memory);
+  prefs_register_uint_preference(spdy_module, "spool_threshold",
+                                 "Spool entity bodies larger than (KB)",
+                                 "Reassembled entity bodies larger than this "
+                                 "are written to temporary files as their "
+                                 "DATA frames arrive, for File > Export "
+                                 "Objects, rather than kept in memory. They "
+                                 "are not handed to subdissectors. 0 means "
+                                 "bodies are always kept in memory.",
+                                 10, &spdy_spool_threshold);
+  prefs_register_string_preference(spdy_module, "body_wanted_types",
+                                   "Reassemble and decode only these "
+                                   "content types",
+                                   "Comma-separated media types, such as "
+                                   "\"text/html, application/json, text/*\", "
+                                   "whose entity bodies are reassembled and "
+                                   "decoded. The DATA frames of other bodies "
+                                   "are only counted. Empty means all "
+                                   "content types.",
+                                   &spdy_body_wanted_types);
+  prefs_register_string_preference(spdy_module, "body_unwanted_types",
+                                   "Never reassemble or decode these "
+                                   "content types",
+                                   "Comma-separated media types, such as "
+                                   "\"video/*, image/*\", whose entity "
+                                   "bodies are not reassembled or decoded, "
+                                   "whatever the list above says.",
+                                   &spdy_body_unwanted_types);
+  prefs_register_uint_preference(spdy_module, "max_body_size",
+                                 "Maximum size of each entity body (KB)",
+                                 "Entity bodies that grow past this are "
+                                 "dropped, and their later DATA frames only "
+                                 "counted. 0 means no limit.",
+                                 10, &spdy_max_body_size);
+#ifndef SPDY_DISABLE_DEBUG
   prefs_register_bool_preference(spdy_module, "debug_output",
                                  "Print debug info on stdout",
                                  "Print debug info on stdout",
                                  &spdy_debug);
+#else
+  prefs_register_obsolete_preference(spdy_module, "debug_output");
+#endif
 
   /** Create dissector handle and register for dissection. */
   spdy_handle = new_create_dissector_handle(dissect_spdy, proto_spdy);
@@ -2327,5 +6493,13 @@ void proto_register_spdy(void) {
 void proto_reg_handoff_spdy(void) {
   data_handle = find_dissector("data");
   media_handle = find_dissector("media");
+  port_subdissector_table = find_dissector_table("http.port");
+  media_type_subdissector_table = find_dissector_table("media_type");
   heur_dissector_add("tcp", dissect_spdy_heur, proto_spdy);
+
+  stats_tree_register_plugin("spdy", "spdy", "SPDY/Frame Counter", 0,
+                             spdy_stats_tree_packet, spdy_stats_tree_init,
+                             NULL);
+  register_stat_cmd_arg("spdy,perf", spdy_perf_init, NULL);
+  register_stat_cmd_arg("follow,spdy,", spdy_follow_init, NULL);
 }
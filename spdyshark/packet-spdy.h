@@ -31,19 +31,177 @@
 #pragma once
 
 #include <epan/packet.h>
-#ifdef HAVE_LIBZ
-#include <zlib.h>
-#endif
+#include "spdy-parse.h"
+
+/* SYN_STREAM priorities are 3 bits; 0 is the highest. */
+#define SPDY_NUM_PRIORITIES 8
+
+/* Setting IDs are tracked up to, but not including, this one. */
+#define SPDY_NUM_SETTINGS 9
+
+/* Which way a frame was sent, when known. */
+typedef enum _spdy_direction_t {
+    SPDY_DIRECTION_UNKNOWN,
+    SPDY_DIRECTION_TO_SERVER,
+    SPDY_DIRECTION_TO_CLIENT
+} spdy_direction_t;
+
+/*
+ * A DATA frame whose payload runs on past the segment its header was in.
+ */
+typedef struct _spdy_partial_data_t {
+    guint32  stream_id;
+    guint8   flags;
+    guint32  length;      /* of the whole payload */
+    guint32  remaining;   /* payload bytes still to come */
+} spdy_partial_data_t;
+
+/*
+ * The SETTINGS one endpoint has in effect: a value for each setting ID
+ * that has been set, and which of them were persisted.
+ */
+typedef struct _spdy_settings_t {
+    guint32  values[SPDY_NUM_SETTINGS];
+    guint16  present;     /* bit mask, by setting ID */
+    guint16  persisted;
+} spdy_settings_t;
+
+/* Whether a conversation's header blocks are being read from the cache. */
+typedef enum _spdy_header_cache_use_t {
+    SPDY_HEADER_CACHE_UNDECIDED,
+    SPDY_HEADER_CACHE_READING,
+    SPDY_HEADER_CACHE_INFLATING
+} spdy_header_cache_use_t;
 
 /*
  * Conversation data - used for assembling multi-data-frame
  * entities and for decompressing request & reply header blocks.
  */
 typedef struct _spdy_conv_t {
+    /* Header block inflaters, set up on the first block in each direction. */
     z_streamp rqst_decompressor;
     z_streamp rply_decompressor;
-    guint32   dictionary_id;
-    GArray    *streams;
+    gboolean  decompressors_released;
+    /*
+     * The frame the conversation was first seen in, which names it in the
+     * header block cache; how its header blocks are being got; the blocks
+     * read from the cache so far (spdy_cached_block_t, newest first), to
+     * inflate should a later one be missing; and, while a cache file is
+     * written, whether any of its blocks failed to be stored.
+     */
+    guint32   first_frame;
+    spdy_header_cache_use_t cache_use;
+    GSList   *cached_blocks;
+    gboolean  cache_incomplete;
+    GHashTable *streams;  /* spdy_stream_info_t, keyed by stream ID */
+    GHashTable *stream_frames;  /* spdy_stream_frames_t, keyed by stream ID */
+    GHashTable *pings;    /* unanswered PINGs (spdy_ping_t), keyed by ID */
+    spdy_inflate_buf_t inflate_buf;   /* header block inflate scratch space */
+    /* The endpoint that opened the connection, once a SYN_STREAM says so. */
+    gboolean  client_known;
+    address   client_addr;
+    guint32   client_port;
+    /* Which way the segment now being dissected was sent. */
+    spdy_direction_t direction;
+    /*
+     * DATA frames still being received, on the first pass, by the side
+     * sending them (see spdy_segment_side()).
+     */
+    spdy_partial_data_t partial_data[2];
+    /*
+     * Flow control, indexed by sending direction (SPDY_DIRECTION_TO_SERVER
+     * or SPDY_DIRECTION_TO_CLIENT, less one): the send window new streams
+     * start with, and the connection-level send window, which is only
+     * tracked once a WINDOW_UPDATE for stream 0 shows it is in use.
+     */
+    gint32    initial_window[2];
+    gboolean  conn_flow_control;
+    gint64    conn_window[2];
+    /*
+     * Priority inversions: DATA payload bytes sent so far in each direction
+     * by streams of each priority, indexed the same way, and the number of
+     * DATA frames that lower-priority DATA went ahead of, with those bytes.
+     */
+    guint64   data_bytes_by_priority[2][SPDY_NUM_PRIORITIES];
+    guint32   priority_inversions;
+    guint64   bytes_ahead;
+    /*
+     * Header block bytes sent so far, compressed and inflated: in each
+     * direction, indexed the same way, and in all, at index 2.
+     */
+    guint64   header_comp[3];
+    guint64   header_uncomp[3];
+    /*
+     * Each side's settings, indexed by the direction it sends in, and the
+     * streams each side has open, indexed by the direction their opener
+     * sends in.
+     */
+    spdy_settings_t settings[2];
+    guint32   open_streams[2];
+    /*
+     * Server push: streams pushed and reset so far, and the DATA bytes of
+     * pushed streams that completed and of those that were reset.
+     */
+    guint32   pushes;
+    guint32   pushes_reset;
+    guint64   push_useful_bytes;
+    guint64   push_wasted_bytes;
 } spdy_conv_t;
 
+/*
+ * Tap record, queued to the "spdy" tap for each frame, and for the rest of
+ * each DATA frame that carries on into later segments.
+ */
+typedef struct _spdy_tap_info_t {
+    guint16  type;
+    guint8   flags;
+    gboolean continued;          /* more of a DATA frame already tapped */
+    guint32  stream_id;          /* 0 for frames without a stream */
+    guint32  length;             /* payload length, excluding the frame header */
+    guint32  header_block_len;   /* compressed; header-bearing frames only */
+    guint32  header_block_uncomp_len;
+    /* The same, running totals for the direction and for the connection */
+    guint64  dir_header_comp;
+    guint64  dir_header_uncomp;
+    guint64  conv_header_comp;
+    guint64  conv_header_uncomp;
+    spdy_direction_t direction;
+    /* Capture-wide stream number, and the frames carrying the stream. */
+    gboolean has_stream_index;
+    guint32  stream_index;
+    const GArray *stream_frames;
+    /* DATA payload in this segment, or the uncompressed header block. */
+    const guint8 *payload;
+    guint32  payload_len;
+    /*
+     * DATA frames from streams whose priority is known: lower-priority DATA
+     * bytes sent while the stream had data pending, and the connection's
+     * priority inversions so far.
+     */
+    gboolean has_priority;
+    guint8   priority;
+    guint32  bytes_ahead;
+    guint32  conv_priority_inversions;
+    guint64  conv_bytes_ahead;
+    /* Frames ending a pushed stream: how it ended, and the bytes pushed */
+    guint8   push_outcome;
+    guint64  pushed_bytes;
+} spdy_tap_info_t;
+
+/*
+ * Export object record, queued to the "spdy_eo" tap for each complete
+ * entity body. Large bodies are spooled to a temporary file rather than
+ * held in memory; payload_data is then NULL and spool_path names the file,
+ * which stays around until the capture is closed.
+ */
+typedef struct _spdy_eo_t {
+    guint32       pkt_num;
+    const gchar  *hostname;
+    gchar        *filename;
+    const gchar  *content_type;
+    guint32       payload_len;
+    const guint8 *payload_data;
+    const gchar  *spool_path;
+} spdy_eo_t;
+
 #endif /* __PACKET_SPDY_H__ */
@@ -0,0 +1,1094 @@
+/* spdy-analyze.c
+ * Summarizes the SPDY streams in a capture, without Wireshark
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+/*
+ * Reads a libpcap capture and writes one tab-separated line per SPDY
+ * stream: who and what it was for, its priority, its header and body
+ * sizes, how long the reply, the first response byte and the whole
+ * stream took, and how it ended.
+ *
+ * SPDY state is per TCP connection, so connections are spread over a
+ * number of worker threads by a hash of their addresses and ports. The
+ * main thread only reads the capture and decodes as far as TCP; each
+ * worker puts its connections' byte streams back together and parses
+ * them with the routines in spdy-parse.c. Lines are sorted by the frame
+ * each stream started in, so the output doesn't depend on the number of
+ * threads: each worker writes its lines out in sorted runs to temporary
+ * files as it goes, and the runs are merged once the capture is read.
+ *
+ * TCP reassembly is simple: a side of a connection is given up on at the
+ * first lost segment, which is reported on stderr, and streams still open
+ * on the connection then end as "lost". Connections whose handshake
+ * wasn't captured are ignored, since their header blocks can't be
+ * inflated, and a new SYN on a 4-tuple that's in use starts a new
+ * connection.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <zlib.h>
+
+#include "spdy-parse.h"
+
+#define ANALYZE_DEFAULT_THREADS 4
+#define ANALYZE_MAX_THREADS 256
+
+/* Packets handed to a worker at a time, and batches in flight per worker. */
+#define ANALYZE_BATCH_PACKETS 512
+#define ANALYZE_BATCHES_PER_WORKER 8
+
+/* Lines a worker holds before writing them out as a sorted run. */
+#define ANALYZE_RUN_RECORDS 65536
+
+#define LINKTYPE_NULL 0
+#define LINKTYPE_ETHERNET 1
+#define LINKTYPE_RAW 101
+#define LINKTYPE_LINUX_SLL 113
+
+#define ETHERTYPE_IP 0x0800
+#define ETHERTYPE_VLAN 0x8100
+#define ETHERTYPE_IPV6 0x86dd
+
+#define IP_PROTO_TCP 6
+
+#define TCP_FIN 0x01
+#define TCP_SYN 0x02
+#define TCP_RST 0x04
+#define TCP_ACK 0x10
+
+/*
+ * A TCP connection's endpoints, in a fixed order so that both directions
+ * map to the same key. Addresses are IPv4 in the first four bytes, or
+ * IPv6.
+ */
+typedef struct _analyze_conn_key_t {
+  guint8  addr[2][16];
+  guint16 port[2];
+  guint8  ipv6;
+} analyze_conn_key_t;
+
+/* A TCP segment, as passed from the reader to a worker. */
+typedef struct _analyze_packet_t {
+  analyze_conn_key_t key;
+  guint64 frame;
+  gdouble ts;
+  guint   sender;             /* index of the sending endpoint in key */
+  guint32 seq;
+  guint8  tcp_flags;
+  guint   payload_offset;     /* in the batch's payload buffer */
+  guint   payload_len;
+} analyze_packet_t;
+
+typedef struct _analyze_batch_t {
+  guint count;
+  gboolean last;              /* no more batches follow */
+  analyze_packet_t packets[ANALYZE_BATCH_PACKETS];
+  GByteArray *payloads;
+} analyze_batch_t;
+
+/* What is known of a stream; summarized once it's over. */
+typedef struct _analyze_stream_t {
+  guint64 first_frame;
+  guint32 stream_id;
+  guint32 associated_stream_id;
+  guint8  priority;
+  guint   opener;             /* endpoint index */
+  gdouble start_ts;
+  gdouble reply_ts;           /* 0 until seen */
+  gdouble first_data_ts;      /* from the peer of the opener */
+  gdouble last_ts;
+  gchar  *method;
+  gchar  *host;
+  gchar  *path;
+  gchar  *status;
+  /* Indexed by opener (0) and its peer (1) */
+  guint64 header_comp[2];
+  guint64 header_uncomp[2];
+  guint64 data_bytes[2];
+  gboolean closed[2];
+  gchar  *end;                /* how it ended, if it did */
+} analyze_stream_t;
+
+/* One side of a TCP connection: what it sends. */
+typedef struct _analyze_half_t {
+  gboolean seq_known;
+  guint32  isn;               /* from its SYN */
+  guint32  next_seq;
+  gboolean lost;              /* out of sync; ignored from here on */
+  gboolean fin;
+  gboolean checked;           /* first bytes looked at */
+  gboolean spdy;
+  GByteArray *buf;            /* bytes not yet parsed */
+  z_streamp inflater;
+} analyze_half_t;
+
+typedef struct _analyze_conn_t {
+  analyze_conn_key_t key;
+  analyze_half_t half[2];
+  gboolean spdy;
+  GHashTable *streams;        /* analyze_stream_t, by stream ID */
+} analyze_conn_t;
+
+/* A line of output, with what it's sorted by. */
+typedef struct _analyze_record_t {
+  guint64 frame;
+  guint32 stream_id;
+  gchar  *line;
+} analyze_record_t;
+
+/* A sorted run of records being read back, for merging. */
+typedef struct _analyze_run_t {
+  FILE   *fp;
+  gboolean done;
+  analyze_record_t rec;       /* the next one */
+  GString *line;
+} analyze_run_t;
+
+typedef struct _analyze_worker_t {
+  GThread *thread;
+  GAsyncQueue *todo;          /* batches to be analyzed */
+  GAsyncQueue *free;          /* and those done with */
+  GHashTable *conns;          /* analyze_conn_t, by key */
+  spdy_inflate_buf_t inflate_buf;
+  GArray *records;            /* not yet written out */
+  GPtrArray *runs;            /* FILE *, each a sorted run */
+  /* Totals */
+  guint64 conns_seen;
+  guint64 spdy_conns;
+  guint64 lost_halves;
+  guint64 bad_header_blocks;
+} analyze_worker_t;
+
+static void die(const char *msg) {
+  fprintf(stderr, "spdy-analyze: %s\n", msg);
+  exit(1);
+}
+
+static guint16 get16(const guint8 *p) {
+  return (guint16)((p[0] << 8) | p[1]);
+}
+
+static guint32 get32(const guint8 *p) {
+  return ((guint32)p[0] << 24) | ((guint32)p[1] << 16) |
+      ((guint32)p[2] << 8) | p[3];
+}
+
+/* FNV-1a */
+static guint analyze_conn_key_hash(gconstpointer k) {
+  const guint8 *p = k;
+  guint32 h = 2166136261U;
+  guint i;
+
+  for (i = 0; i < sizeof(analyze_conn_key_t); i++) {
+    h = (h ^ p[i]) * 16777619U;
+  }
+  return h;
+}
+
+static gboolean analyze_conn_key_equal(gconstpointer a, gconstpointer b) {
+  return memcmp(a, b, sizeof(analyze_conn_key_t)) == 0;
+}
+
+/*
+ * Fills in the key for a segment from src to dst, and returns the index
+ * of the sender within it.
+ */
+static guint analyze_make_key(analyze_conn_key_t *key, const guint8 *src,
+                              const guint8 *dst, guint addr_len,
+                              guint16 sport, guint16 dport) {
+  int cmp = memcmp(src, dst, addr_len);
+  guint sender = (cmp > 0 || (cmp == 0 && sport > dport)) ? 1 : 0;
+
+  memset(key, 0, sizeof(*key));
+  key->ipv6 = addr_len == 16;
+  memcpy(key->addr[sender], src, addr_len);
+  memcpy(key->addr[!sender], dst, addr_len);
+  key->port[sender] = sport;
+  key->port[!sender] = dport;
+  return sender;
+}
+
+static gchar *analyze_endpoint_str(const analyze_conn_key_t *key, guint i) {
+  const guint8 *a = key->addr[i];
+
+  if (!key->ipv6) {
+    return g_strdup_printf("%u.%u.%u.%u:%u", a[0], a[1], a[2], a[3],
+                           key->port[i]);
+  }
+  return g_strdup_printf("[%x:%x:%x:%x:%x:%x:%x:%x]:%u",
+                         get16(a), get16(a + 2), get16(a + 4), get16(a + 6),
+                         get16(a + 8), get16(a + 10), get16(a + 12),
+                         get16(a + 14), key->port[i]);
+}
+
+static gchar *analyze_ms_str(gdouble from, gdouble to) {
+  if (from == 0 || to == 0) {
+    return g_strdup("-");
+  }
+  return g_strdup_printf("%.3f", (to - from) * 1000);
+}
+
+static void analyze_free_stream(gpointer data) {
+  analyze_stream_t *st = data;
+
+  g_free(st->method);
+  g_free(st->host);
+  g_free(st->path);
+  g_free(st->status);
+  g_free(st->end);
+  g_free(st);
+}
+
+static int analyze_record_compare(gconstpointer a, gconstpointer b) {
+  const analyze_record_t *ra = a;
+  const analyze_record_t *rb = b;
+
+  if (ra->frame != rb->frame) {
+    return ra->frame < rb->frame ? -1 : 1;
+  }
+  if (ra->stream_id != rb->stream_id) {
+    return ra->stream_id < rb->stream_id ? -1 : 1;
+  }
+  return 0;
+}
+
+/*
+ * Sorts the lines a worker holds and writes them to a temporary file of
+ * their own, each as its sort keys, its length and its text.
+ */
+static void analyze_write_run(analyze_worker_t *w) {
+  FILE *fp;
+  guint i;
+
+  if (w->records->len == 0) {
+    return;
+  }
+  fp = tmpfile();
+  if (fp == NULL) {
+    die("can't create a temporary file");
+  }
+  g_array_sort(w->records, analyze_record_compare);
+  for (i = 0; i < w->records->len; i++) {
+    analyze_record_t *r = &g_array_index(w->records, analyze_record_t, i);
+    guint32 len = (guint32)strlen(r->line);
+
+    if (fwrite(&r->frame, sizeof(r->frame), 1, fp) != 1 ||
+        fwrite(&r->stream_id, sizeof(r->stream_id), 1, fp) != 1 ||
+        fwrite(&len, sizeof(len), 1, fp) != 1 ||
+        fwrite(r->line, 1, len, fp) != len) {
+      die("can't write a temporary file");
+    }
+    g_free(r->line);
+  }
+  if (fflush(fp) != 0 || fseek(fp, 0, SEEK_SET) != 0) {
+    die("can't write a temporary file");
+  }
+  g_ptr_array_add(w->runs, fp);
+  g_array_set_size(w->records, 0);
+}
+
+/*
+ * Reads the next record of a run, if there is one.
+ */
+static void analyze_read_run(analyze_run_t *run) {
+  guint32 len;
+
+  if (fread(&run->rec.frame, sizeof(run->rec.frame), 1, run->fp) != 1) {
+    run->done = TRUE;
+    return;
+  }
+  if (fread(&run->rec.stream_id, sizeof(run->rec.stream_id), 1,
+            run->fp) != 1 ||
+      fread(&len, sizeof(len), 1, run->fp) != 1) {
+    die("can't read a temporary file");
+  }
+  g_string_set_size(run->line, len);
+  if (fread(run->line->str, 1, len, run->fp) != len) {
+    die("can't read a temporary file");
+  }
+}
+
+/*
+ * Writes out a stream's summary line.
+ */
+static void analyze_emit_stream(analyze_worker_t *w, analyze_conn_t *conn,
+                                analyze_stream_t *st, const gchar *end) {
+  analyze_record_t rec;
+  guint opener = st->opener;
+  gchar *from = analyze_endpoint_str(&conn->key, opener);
+  gchar *to = analyze_endpoint_str(&conn->key, !opener);
+  gchar *reply_ms = analyze_ms_str(st->start_ts, st->reply_ts);
+  gchar *first_byte_ms = analyze_ms_str(st->start_ts, st->first_data_ts);
+  gchar *duration_ms = analyze_ms_str(st->start_ts, st->last_ts);
+
+  rec.frame = st->first_frame;
+  rec.stream_id = st->stream_id;
+  rec.line = g_strdup_printf(
+      "%" G_GINT64_MODIFIER "u\t%s\t%s\t%u\t%u\t%u\t%s\t%s\t%s\t%s\t"
+      "%" G_GINT64_MODIFIER "u\t%" G_GINT64_MODIFIER "u\t"
+      "%" G_GINT64_MODIFIER "u\t%" G_GINT64_MODIFIER "u\t"
+      "%" G_GINT64_MODIFIER "u\t%" G_GINT64_MODIFIER "u\t%s\t%s\t%s\t%s",
+      st->first_frame, from, to, st->stream_id, st->associated_stream_id,
+      st->priority,
+      st->method ? st->method : "-", st->host ? st->host : "-",
+      st->path ? st->path : "-", st->status ? st->status : "-",
+      st->header_comp[0], st->header_uncomp[0],
+      st->header_comp[1], st->header_uncomp[1],
+      st->data_bytes[0], st->data_bytes[1],
+      reply_ms, first_byte_ms, duration_ms,
+      st->end ? st->end : end);
+  g_array_append_val(w->records, rec);
+  if (w->records->len >= ANALYZE_RUN_RECORDS) {
+    analyze_write_run(w);
+  }
+  g_free(from);
+  g_free(to);
+  g_free(reply_ms);
+  g_free(first_byte_ms);
+  g_free(duration_ms);
+}
+
+static void analyze_emit_open_stream(gpointer key _U_, gpointer value,
+                                     gpointer user_data) {
+  gpointer *args = user_data;
+
+  analyze_emit_stream(args[0], args[1], value, args[2]);
+}
+
+/*
+ * Drops a connection, summing up the streams still open on it.
+ */
+static void analyze_free_conn(analyze_worker_t *w, analyze_conn_t *conn) {
+  gpointer args[3];
+  guint i;
+
+  args[0] = w;
+  args[1] = conn;
+  args[2] = conn->half[0].lost || conn->half[1].lost ? "lost" : "open";
+  g_hash_table_foreach(conn->streams, analyze_emit_open_stream, args);
+  g_hash_table_destroy(conn->streams);
+  for (i = 0; i < 2; i++) {
+    g_byte_array_free(conn->half[i].buf, TRUE);
+    spdy_free_header_inflater(conn->half[i].inflater);
+  }
+  g_free(conn);
+}
+
+static void analyze_end_stream(analyze_worker_t *w, analyze_conn_t *conn,
+                               analyze_stream_t *st, const gchar *end) {
+  analyze_emit_stream(w, conn, st, end);
+  g_hash_table_remove(conn->streams, GUINT_TO_POINTER(st->stream_id));
+}
+
+/* Replaces *field with a copy of a header value. */
+static void analyze_set_str(gchar **field, const guint8 *value, guint32 len) {
+  guint32 i;
+
+  g_free(*field);
+  *field = g_strndup((const gchar *)value, len);
+  /* Tabs and newlines would break up the line. */
+  for (i = 0; (*field)[i] != '\0'; i++) {
+    if ((*field)[i] == '\t' || (*field)[i] == '\n' || (*field)[i] == '\r') {
+      (*field)[i] = ' ';
+    }
+  }
+}
+
+static gboolean analyze_name_is(const spdy_header_iter_t *headers,
+                                const char *name) {
+  return headers->name_length == strlen(name) &&
+      memcmp(headers->name, name, headers->name_length) == 0;
+}
+
+/*
+ * Gives up on what sender sends from here on, saying so.
+ */
+static void analyze_lose_half(analyze_worker_t *w, analyze_conn_t *conn,
+                              guint sender, const analyze_packet_t *pkt,
+                              const char *why) {
+  analyze_half_t *half = &conn->half[sender];
+  gchar *from;
+  gchar *to;
+
+  half->lost = TRUE;
+  if (half->checked && !half->spdy) {
+    /* Its bytes were going unread anyway. */
+    return;
+  }
+  w->lost_halves++;
+  from = analyze_endpoint_str(&conn->key, sender);
+  to = analyze_endpoint_str(&conn->key, !sender);
+  fprintf(stderr, "spdy-analyze: %s -> %s: %s in frame %" G_GINT64_MODIFIER
+          "u; ignoring the rest of this side\n", from, to, why, pkt->frame);
+  g_free(from);
+  g_free(to);
+}
+
+/*
+ * Inflates a header block sent by sender, counting it against the stream
+ * if there is one, and picking out the request and response line.
+ */
+static void analyze_header_block(analyze_worker_t *w, analyze_conn_t *conn,
+                                 guint sender, const analyze_packet_t *pkt,
+                                 analyze_stream_t *st,
+                                 const guint8 *block, guint32 length) {
+  analyze_half_t *half = &conn->half[sender];
+  spdy_header_iter_t headers;
+  guint uncomp_length;
+  guint side;
+
+  if (half->inflater == NULL) {
+    half->inflater = spdy_new_header_inflater();
+  }
+  if (half->inflater == NULL ||
+      !spdy_inflate_header_block(half->inflater, block, length,
+                                 &w->inflate_buf, &uncomp_length,
+                                 NULL, NULL)) {
+    /* The inflater can't be trusted for later blocks either. */
+    w->bad_header_blocks++;
+    analyze_lose_half(w, conn, sender, pkt, "header block failed to inflate");
+    return;
+  }
+  if (st == NULL) {
+    return;
+  }
+  side = sender == st->opener ? 0 : 1;
+  st->header_comp[side] += length;
+  st->header_uncomp[side] += uncomp_length;
+  if (!spdy_header_iter_init(&headers, w->inflate_buf.data, uncomp_length)) {
+    return;
+  }
+  while (spdy_header_iter_next(&headers) == SPDY_HEADER_PAIR) {
+    if (analyze_name_is(&headers, ":method")) {
+      analyze_set_str(&st->method, headers.value, headers.value_length);
+    } else if (analyze_name_is(&headers, ":host")) {
+      analyze_set_str(&st->host, headers.value, headers.value_length);
+    } else if (analyze_name_is(&headers, ":path")) {
+      analyze_set_str(&st->path, headers.value, headers.value_length);
+    } else if (analyze_name_is(&headers, ":status")) {
+      analyze_set_str(&st->status, headers.value, headers.value_length);
+    }
+  }
+}
+
+/* Marks a side of a stream closed, and ends the stream once both are. */
+static void analyze_close_side(analyze_worker_t *w, analyze_conn_t *conn,
+                               analyze_stream_t *st, guint sender) {
+  st->closed[sender == st->opener ? 0 : 1] = TRUE;
+  if (st->closed[0] && st->closed[1]) {
+    analyze_end_stream(w, conn, st, "fin");
+  }
+}
+
+/*
+ * Handles one complete frame sent by sender.
+ */
+static void analyze_frame(analyze_worker_t *w, analyze_conn_t *conn,
+                          guint sender, const analyze_packet_t *pkt,
+                          const spdy_frame_header_t *hdr,
+                          const guint8 *payload) {
+  spdy_header_frame_t fields;
+  analyze_stream_t *st;
+
+  if (!hdr->control) {
+    st = g_hash_table_lookup(conn->streams,
+                             GUINT_TO_POINTER(hdr->stream_id));
+    if (st == NULL) {
+      return;
+    }
+    st->last_ts = pkt->ts;
+    st->data_bytes[sender == st->opener ? 0 : 1] += hdr->length;
+    if (sender != st->opener && st->first_data_ts == 0 && hdr->length != 0) {
+      st->first_data_ts = pkt->ts;
+    }
+    if (hdr->flags & SPDY_FLAG_FIN) {
+      analyze_close_side(w, conn, st, sender);
+    }
+    return;
+  }
+
+  switch (hdr->type) {
+    case SPDY_SYN_STREAM:
+    case SPDY_SYN_REPLY:
+    case SPDY_HEADERS:
+      if (!spdy_parse_header_frame(hdr->type, payload, hdr->length,
+                                   &fields)) {
+        return;
+      }
+      st = g_hash_table_lookup(conn->streams,
+                               GUINT_TO_POINTER(fields.stream_id));
+      if (hdr->type == SPDY_SYN_STREAM && st == NULL) {
+        st = g_new0(analyze_stream_t, 1);
+        st->first_frame = pkt->frame;
+        st->stream_id = fields.stream_id;
+        st->associated_stream_id = fields.associated_stream_id;
+        st->priority = fields.priority;
+        st->opener = sender;
+        st->start_ts = pkt->ts;
+        g_hash_table_insert(conn->streams, GUINT_TO_POINTER(st->stream_id),
+                            st);
+      }
+      if (st != NULL) {
+        st->last_ts = pkt->ts;
+        if (hdr->type == SPDY_SYN_REPLY && st->reply_ts == 0) {
+          st->reply_ts = pkt->ts;
+        }
+      }
+      /* Every block has to be inflated, to keep the inflater in step. */
+      analyze_header_block(w, conn, sender, pkt, st,
+                           payload + fields.header_block_offset,
+                           fields.header_block_length);
+      if (st == NULL) {
+        return;
+      }
+      if (hdr->type == SPDY_SYN_STREAM &&
+          (hdr->flags & SPDY_FLAG_UNIDIRECTIONAL)) {
+        /* Pushed streams only ever go one way. */
+        st->closed[1] = TRUE;
+      }
+      if (hdr->flags & SPDY_FLAG_FIN) {
+        analyze_close_side(w, conn, st, sender);
+      }
+      break;
+
+    case SPDY_RST_STREAM:
+      if (hdr->length < 8) {
+        return;
+      }
+      st = g_hash_table_lookup(conn->streams,
+                               GUINT_TO_POINTER(get32(payload) & 0x7fffffff));
+      if (st != NULL) {
+        gchar *end = g_strdup_printf("rst:%u", get32(payload + 4));
+
+        st->last_ts = pkt->ts;
+        analyze_end_stream(w, conn, st, end);
+        g_free(end);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+/*
+ * Parses as many whole frames as a side of a connection has sent.
+ */
+static void analyze_parse_half(analyze_worker_t *w, analyze_conn_t *conn,
+                               guint sender, const analyze_packet_t *pkt) {
+  analyze_half_t *half = &conn->half[sender];
+  guint pos = 0;
+
+  if (!half->checked && half->buf->len >= SPDY_FRAME_HEADER_LEN) {
+    spdy_frame_header_t hdr;
+
+    /* A SPDY/3 control frame of a known type, or it's not SPDY. */
+    spdy_parse_frame_header(half->buf->data, &hdr);
+    half->checked = TRUE;
+    half->spdy = hdr.control && hdr.version == 3 && hdr.type != SPDY_DATA &&
+        hdr.type < SPDY_INVALID;
+    if (half->spdy && !conn->spdy) {
+      conn->spdy = TRUE;
+      w->spdy_conns++;
+    }
+  }
+  if (!half->checked) {
+    return;
+  }
+  if (!half->spdy) {
+    g_byte_array_set_size(half->buf, 0);
+    return;
+  }
+
+  while (!half->lost && half->buf->len - pos >= SPDY_FRAME_HEADER_LEN) {
+    spdy_frame_header_t hdr;
+
+    spdy_parse_frame_header(half->buf->data + pos, &hdr);
+    if (half->buf->len - pos - SPDY_FRAME_HEADER_LEN < hdr.length) {
+      break;
+    }
+    analyze_frame(w, conn, sender, pkt, &hdr,
+                  half->buf->data + pos + SPDY_FRAME_HEADER_LEN);
+    pos += SPDY_FRAME_HEADER_LEN + hdr.length;
+  }
+  if (half->lost) {
+    g_byte_array_set_size(half->buf, 0);
+  } else if (pos != 0) {
+    g_byte_array_remove_range(half->buf, 0, pos);
+  }
+}
+
+static analyze_conn_t *analyze_new_conn(analyze_worker_t *w,
+                                        const analyze_conn_key_t *key) {
+  analyze_conn_t *conn = g_new0(analyze_conn_t, 1);
+
+  conn->key = *key;
+  conn->half[0].buf = g_byte_array_new();
+  conn->half[1].buf = g_byte_array_new();
+  conn->streams = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                        NULL, analyze_free_stream);
+  g_hash_table_insert(w->conns, &conn->key, conn);
+  w->conns_seen++;
+  return conn;
+}
+
+/*
+ * Adds a segment to its connection's byte stream, and parses what that
+ * completes.
+ */
+static void analyze_segment(analyze_worker_t *w, const analyze_packet_t *pkt,
+                            const guint8 *payload) {
+  analyze_conn_t *conn = g_hash_table_lookup(w->conns, &pkt->key);
+  analyze_half_t *half;
+  guint32 len = pkt->payload_len;
+  gint32 ahead;
+
+  if (conn != NULL && (pkt->tcp_flags & (TCP_SYN | TCP_ACK)) == TCP_SYN &&
+      !(conn->half[pkt->sender].seq_known &&
+        conn->half[pkt->sender].isn == pkt->seq)) {
+    /* A new connection on the same 4-tuple; the old one is over. */
+    g_hash_table_remove(w->conns, &conn->key);
+    analyze_free_conn(w, conn);
+    conn = NULL;
+  }
+  if (conn == NULL) {
+    /* Connections are only followed from their handshake. */
+    if (!(pkt->tcp_flags & TCP_SYN)) {
+      return;
+    }
+    conn = analyze_new_conn(w, &pkt->key);
+  }
+  half = &conn->half[pkt->sender];
+
+  if (pkt->tcp_flags & TCP_SYN) {
+    half->seq_known = TRUE;
+    half->isn = pkt->seq;
+    half->next_seq = pkt->seq + 1;
+  } else if (len != 0 && !half->lost) {
+    if (!half->seq_known) {
+      analyze_lose_half(w, conn, pkt->sender, pkt, "handshake not captured");
+    } else {
+      ahead = (gint32)(pkt->seq - half->next_seq);
+      if (ahead > 0) {
+        /* A segment was missed; the byte stream can't be trusted. */
+        analyze_lose_half(w, conn, pkt->sender, pkt, "segment missing");
+      } else if ((guint32)-ahead < len) {
+        /* Skip anything retransmitted. */
+        g_byte_array_append(half->buf, payload - ahead, len + ahead);
+        half->next_seq += len + ahead;
+        analyze_parse_half(w, conn, pkt->sender, pkt);
+      }
+    }
+  }
+
+  if (pkt->tcp_flags & TCP_RST) {
+    g_hash_table_remove(w->conns, &conn->key);
+    analyze_free_conn(w, conn);
+  } else if (pkt->tcp_flags & TCP_FIN) {
+    half->fin = TRUE;
+    if (conn->half[!pkt->sender].fin) {
+      g_hash_table_remove(w->conns, &conn->key);
+      analyze_free_conn(w, conn);
+    }
+  }
+}
+
+static void analyze_free_conn_cb(gpointer key _U_, gpointer value,
+                                 gpointer user_data) {
+  analyze_free_conn(user_data, value);
+}
+
+static gpointer analyze_worker(gpointer data) {
+  analyze_worker_t *w = data;
+  analyze_batch_t *batch;
+  gboolean last;
+  guint i;
+
+  do {
+    batch = g_async_queue_pop(w->todo);
+    for (i = 0; i < batch->count; i++) {
+      const analyze_packet_t *pkt = &batch->packets[i];
+
+      analyze_segment(w, pkt, batch->payloads->data + pkt->payload_offset);
+    }
+    last = batch->last;
+    batch->count = 0;
+    g_byte_array_set_size(batch->payloads, 0);
+    g_async_queue_push(w->free, batch);
+  } while (!last);
+
+  /* The capture's over; sum up what's left. */
+  g_hash_table_foreach(w->conns, analyze_free_conn_cb, w);
+  g_hash_table_destroy(w->conns);
+  w->conns = NULL;
+  analyze_write_run(w);
+  spdy_free_inflate_buf(&w->inflate_buf);
+  return NULL;
+}
+
+/*
+ * Decodes a captured frame as far as TCP. Returns FALSE if it isn't a
+ * whole, unfragmented TCP segment over IPv4 or IPv6.
+ */
+static gboolean analyze_decode(guint32 linktype, const guint8 *p, guint len,
+                               analyze_packet_t *pkt,
+                               const guint8 **payload) {
+  guint ethertype = 0;
+  guint ip_len;
+  guint tcp_len;
+  const guint8 *src;
+  const guint8 *dst;
+  guint addr_len;
+
+  switch (linktype) {
+    case LINKTYPE_ETHERNET:
+      if (len < 14) {
+        return FALSE;
+      }
+      ethertype = get16(p + 12);
+      p += 14;
+      len -= 14;
+      while (ethertype == ETHERTYPE_VLAN && len >= 4) {
+        ethertype = get16(p + 2);
+        p += 4;
+        len -= 4;
+      }
+      break;
+    case LINKTYPE_LINUX_SLL:
+      if (len < 16) {
+        return FALSE;
+      }
+      ethertype = get16(p + 14);
+      p += 16;
+      len -= 16;
+      break;
+    case LINKTYPE_NULL:
+      if (len < 4) {
+        return FALSE;
+      }
+      /* The address family, in the byte order of the capturing host. */
+      ethertype = (p[0] == 2 || p[3] == 2) ? ETHERTYPE_IP : ETHERTYPE_IPV6;
+      p += 4;
+      len -= 4;
+      break;
+    case LINKTYPE_RAW:
+      break;
+    default:
+      return FALSE;
+  }
+  if (ethertype == 0 && len != 0) {
+    ethertype = (p[0] >> 4) == 6 ? ETHERTYPE_IPV6 : ETHERTYPE_IP;
+  }
+
+  if (ethertype == ETHERTYPE_IP) {
+    guint hdr_len;
+
+    if (len < 20 || (p[0] >> 4) != 4 || p[9] != IP_PROTO_TCP ||
+        (get16(p + 6) & 0x3fff) != 0) {
+      return FALSE;
+    }
+    hdr_len = (p[0] & 0x0f) * 4;
+    ip_len = get16(p + 2);
+    if (hdr_len < 20 || ip_len < hdr_len || ip_len > len) {
+      return FALSE;
+    }
+    src = p + 12;
+    dst = p + 16;
+    addr_len = 4;
+    p += hdr_len;
+    len = ip_len - hdr_len;
+  } else if (ethertype == ETHERTYPE_IPV6) {
+    if (len < 40 || (p[0] >> 4) != 6 || p[6] != IP_PROTO_TCP) {
+      return FALSE;
+    }
+    ip_len = get16(p + 4);
+    if (ip_len > len - 40) {
+      return FALSE;
+    }
+    src = p + 8;
+    dst = p + 24;
+    addr_len = 16;
+    p += 40;
+    len = ip_len;
+  } else {
+    return FALSE;
+  }
+
+  if (len < 20) {
+    return FALSE;
+  }
+  tcp_len = (p[12] >> 4) * 4;
+  if (tcp_len < 20 || tcp_len > len) {
+    return FALSE;
+  }
+  pkt->sender = analyze_make_key(&pkt->key, src, dst, addr_len,
+                                 get16(p), get16(p + 2));
+  pkt->seq = get32(p + 4);
+  pkt->tcp_flags = p[13];
+  pkt->payload_len = len - tcp_len;
+  *payload = p + tcp_len;
+  return TRUE;
+}
+
+static guint32 pcap_get32(const guint8 *p, gboolean swapped) {
+  return swapped ? get32(p) :
+      ((guint32)p[3] << 24) | ((guint32)p[2] << 16) |
+      ((guint32)p[1] << 8) | p[0];
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "Usage: spdy-analyze [-j <threads>] <capture.pcap>\n"
+          "  -j <n>  worker threads (default %d)\n"
+          "Writes a tab-separated summary line for each SPDY stream.\n",
+          ANALYZE_DEFAULT_THREADS);
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  analyze_worker_t *workers;
+  analyze_batch_t **pending;
+  GPtrArray *runs;
+  FILE *fp;
+  guint8 hdr[24];
+  guint8 rec[16];
+  guint8 *frame_buf;
+  guint32 snaplen;
+  guint32 linktype;
+  gboolean swapped;
+  gboolean nsecs;
+  guint64 frame = 0;
+  guint64 packets = 0;
+  guint64 streams = 0;
+  guint64 spdy_conns = 0;
+  guint64 lost_halves = 0;
+  guint64 bad_header_blocks = 0;
+  guint nthreads = ANALYZE_DEFAULT_THREADS;
+  guint i;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "j:")) != -1) {
+    char *end;
+    unsigned long v;
+
+    switch (opt) {
+      case 'j':
+        v = strtoul(optarg, &end, 10);
+        if (*optarg == '\0' || *end != '\0' || v < 1 ||
+            v > ANALYZE_MAX_THREADS) {
+          usage();
+        }
+        nthreads = (guint)v;
+        break;
+      default:
+        usage();
+    }
+  }
+  if (optind != argc - 1) {
+    usage();
+  }
+
+  fp = fopen(argv[optind], "rb");
+  if (fp == NULL) {
+    perror(argv[optind]);
+    return 1;
+  }
+  if (fread(hdr, sizeof(hdr), 1, fp) != 1) {
+    die("not a libpcap capture");
+  }
+  if (memcmp(hdr, "\xd4\xc3\xb2\xa1", 4) == 0 ||
+      memcmp(hdr, "\x4d\x3c\xb2\xa1", 4) == 0) {
+    swapped = FALSE;
+  } else if (memcmp(hdr, "\xa1\xb2\xc3\xd4", 4) == 0 ||
+             memcmp(hdr, "\xa1\xb2\x3c\x4d", 4) == 0) {
+    swapped = TRUE;
+  } else {
+    die("not a libpcap capture");
+  }
+  nsecs = hdr[swapped ? 2 : 1] == 0x3c;
+  snaplen = MAX(pcap_get32(hdr + 16, swapped), 65535);
+  linktype = pcap_get32(hdr + 20, swapped);
+  frame_buf = g_malloc(snaplen);
+
+#if !GLIB_CHECK_VERSION(2,31,0)
+  g_thread_init(NULL);
+#endif
+  workers = g_new0(analyze_worker_t, nthreads);
+  pending = g_new0(analyze_batch_t *, nthreads);
+  for (i = 0; i < nthreads; i++) {
+    analyze_worker_t *w = &workers[i];
+    guint j;
+
+    w->todo = g_async_queue_new();
+    w->free = g_async_queue_new();
+    for (j = 0; j < ANALYZE_BATCHES_PER_WORKER; j++) {
+      analyze_batch_t *batch = g_new0(analyze_batch_t, 1);
+
+      batch->payloads = g_byte_array_new();
+      g_async_queue_push(w->free, batch);
+    }
+    w->conns = g_hash_table_new(analyze_conn_key_hash,
+                                analyze_conn_key_equal);
+    w->records = g_array_new(FALSE, FALSE, sizeof(analyze_record_t));
+    w->runs = g_ptr_array_new();
+#if GLIB_CHECK_VERSION(2,31,0)
+    w->thread = g_thread_new("spdy-analyze", analyze_worker, w);
+#else
+    w->thread = g_thread_create(analyze_worker, w, TRUE, NULL);
+#endif
+    if (w->thread == NULL) {
+      die("can't start a worker thread");
+    }
+  }
+
+  /* Hand each TCP segment to the worker for its connection. */
+  while (fread(rec, sizeof(rec), 1, fp) == 1) {
+    guint32 caplen = pcap_get32(rec + 8, swapped);
+    analyze_packet_t pkt;
+    const guint8 *payload;
+    analyze_batch_t *batch;
+    analyze_worker_t *w;
+
+    frame++;
+    if (caplen > snaplen) {
+      die("frame larger than the capture's snapshot length");
+    }
+    if (fread(frame_buf, 1, caplen, fp) != caplen) {
+      fprintf(stderr, "spdy-analyze: capture cut short in frame %"
+              G_GINT64_MODIFIER "u\n", frame);
+      break;
+    }
+    if (!analyze_decode(linktype, frame_buf, caplen, &pkt, &payload)) {
+      continue;
+    }
+    packets++;
+    pkt.frame = frame;
+    pkt.ts = pcap_get32(rec, swapped) +
+        pcap_get32(rec + 4, swapped) / (nsecs ? 1e9 : 1e6);
+
+    i = analyze_conn_key_hash(&pkt.key) % nthreads;
+    w = &workers[i];
+    if (pending[i] == NULL) {
+      pending[i] = g_async_queue_pop(w->free);
+    }
+    batch = pending[i];
+    pkt.payload_offset = batch->payloads->len;
+    g_byte_array_append(batch->payloads, payload, pkt.payload_len);
+    batch->packets[batch->count++] = pkt;
+    if (batch->count == ANALYZE_BATCH_PACKETS) {
+      g_async_queue_push(w->todo, batch);
+      pending[i] = NULL;
+    }
+  }
+  fclose(fp);
+  g_free(frame_buf);
+
+  /* Let the workers finish, and collect their runs of lines. */
+  runs = g_ptr_array_new();
+  for (i = 0; i < nthreads; i++) {
+    if (pending[i] == NULL) {
+      pending[i] = g_async_queue_pop(workers[i].free);
+    }
+    pending[i]->last = TRUE;
+    g_async_queue_push(workers[i].todo, pending[i]);
+  }
+  for (i = 0; i < nthreads; i++) {
+    analyze_worker_t *w = &workers[i];
+    analyze_batch_t *batch;
+    guint j;
+
+    g_thread_join(w->thread);
+    for (j = 0; j < w->runs->len; j++) {
+      analyze_run_t *run = g_new0(analyze_run_t, 1);
+
+      run->fp = g_ptr_array_index(w->runs, j);
+      run->line = g_string_new(NULL);
+      analyze_read_run(run);
+      g_ptr_array_add(runs, run);
+    }
+    g_ptr_array_free(w->runs, TRUE);
+    g_array_free(w->records, TRUE);
+    spdy_conns += w->spdy_conns;
+    lost_halves += w->lost_halves;
+    bad_header_blocks += w->bad_header_blocks;
+    while ((batch = g_async_queue_try_pop(w->free)) != NULL) {
+      g_byte_array_free(batch->payloads, TRUE);
+      g_free(batch);
+    }
+    g_async_queue_unref(w->todo);
+    g_async_queue_unref(w->free);
+  }
+  g_free(pending);
+  g_free(workers);
+
+  printf("frame\tfrom\tto\tstream\tassociated\tpriority\tmethod\thost\t"
+         "path\tstatus\treq_header_bytes\treq_header_uncomp\t"
+         "resp_header_bytes\tresp_header_uncomp\treq_bytes\tresp_bytes\t"
+         "reply_ms\tfirst_byte_ms\tduration_ms\tend\n");
+  for (;;) {
+    analyze_run_t *next = NULL;
+
+    for (i = 0; i < runs->len; i++) {
+      analyze_run_t *run = g_ptr_array_index(runs, i);
+
+      if (!run->done && (next == NULL ||
+                         analyze_record_compare(&run->rec, &next->rec) < 0)) {
+        next = run;
+      }
+    }
+    if (next == NULL) {
+      break;
+    }
+    fwrite(next->line->str, 1, next->line->len, stdout);
+    putchar('\n');
+    streams++;
+    analyze_read_run(next);
+  }
+  for (i = 0; i < runs->len; i++) {
+    analyze_run_t *run = g_ptr_array_index(runs, i);
+
+    fclose(run->fp);
+    g_string_free(run->line, TRUE);
+    g_free(run);
+  }
+  g_ptr_array_free(runs, TRUE);
+
+  fprintf(stderr,
+          "spdy-analyze: %" G_GINT64_MODIFIER "u frames, %"
+          G_GINT64_MODIFIER "u TCP segments, %" G_GINT64_MODIFIER
+          "u SPDY connections, %" G_GINT64_MODIFIER "u streams; %"
+          G_GINT64_MODIFIER "u connection sides lost sync, %"
+          G_GINT64_MODIFIER "u header blocks failed to inflate\n",
+          frame, packets, spdy_conns, streams, lost_halves,
+          bad_header_blocks);
+  return 0;
+}
@@ -0,0 +1,713 @@
+/* spdy-bench-gen.c
+ * Writes synthetic SPDY/3 captures for benchmarking the SPDY plugin
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+/*
+ * Each connection is a TCP handshake followed by a number of GET streams,
+ * one after the other, each answered with a SYN_REPLY and a body split
+ * into DATA frames. With -p they are POSTs instead, and each SYN_REPLY
+ * goes out before the last DATA frame of the request body, as servers
+ * that answer early do. Header blocks are compressed with the SPDY/3
+ * dictionary, one zlib stream per direction, as a real endpoint would.
+ * Receivers open each stream's window back up with a WINDOW_UPDATE
+ * whenever the next DATA frame wouldn't fit in it.
+ * Frames go out in TCP segments of at most the MSS, so large frames span
+ * several segments. Clients are numbered up from 10.0.0.1 and all talk
+ * to 10.255.255.254 on the plugin's default TCP port.
+ *
+ * The capture's frame and byte counts are printed when done.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+#include "spdy-dictionary.h"
+
+#define BENCH_SPDY_PORT 6121
+#define BENCH_LINKTYPE_ETHERNET 1
+#define BENCH_SNAPLEN 65535
+
+#define ETH_HDR_LEN 14
+#define IP_HDR_LEN 20
+#define TCP_HDR_LEN 20
+
+#define TCP_FIN 0x01
+#define TCP_SYN 0x02
+#define TCP_PSH 0x08
+#define TCP_ACK 0x10
+
+#define SPDY_SYN_STREAM 1
+#define SPDY_SYN_REPLY 2
+#define SPDY_WINDOW_UPDATE 9
+#define SPDY_FLAG_FIN 0x01
+
+/* No SETTINGS are sent, so every stream window starts at the default. */
+#define SPDY_INITIAL_WINDOW 65536
+
+/* What to generate; set from the command line. */
+typedef struct _bench_params_t {
+  const char *path;
+  unsigned connections;
+  unsigned streams;         /* per connection */
+  unsigned headers;         /* extra headers per header block */
+  unsigned header_size;     /* length of each extra header's value */
+  unsigned body_size;       /* before any gzip */
+  unsigned request_size;    /* POST body; 0 for GETs */
+  unsigned frame_split;     /* largest DATA frame payload */
+  unsigned mss;
+  int gzip;
+} bench_params_t;
+
+/* One side of a TCP connection. */
+typedef struct _bench_endpoint_t {
+  unsigned char addr[4];
+  unsigned short port;
+  unsigned int seq;
+  z_stream deflater;        /* header block compression context */
+} bench_endpoint_t;
+
+/* The capture being written. */
+typedef struct _bench_pcap_t {
+  FILE *fp;
+  unsigned long secs;
+  unsigned long usecs;
+  unsigned long frames;
+  unsigned long long bytes;
+  unsigned short ip_id;
+  unsigned char *buf;
+} bench_pcap_t;
+
+/* Scratch space for a frame, and for compressed header blocks. */
+static unsigned char *frame_buf;
+static size_t frame_buf_size;
+static unsigned char *block_buf;
+static size_t block_buf_size;
+
+static void die(const char *msg) {
+  fprintf(stderr, "spdy-bench-gen: %s\n", msg);
+  exit(1);
+}
+
+static void *xmalloc(size_t size) {
+  void *p = malloc(size ? size : 1);
+  if (p == NULL) {
+    die("out of memory");
+  }
+  return p;
+}
+
+/*
+ * Makes sure a scratch buffer holds at least a given number of bytes.
+ */
+static unsigned char *reserve(unsigned char **buf, size_t *size,
+                              size_t needed) {
+  if (*size < needed) {
+    *buf = realloc(*buf, needed);
+    if (*buf == NULL) {
+      die("out of memory");
+    }
+    *size = needed;
+  }
+  return *buf;
+}
+
+static unsigned char *put16(unsigned char *p, unsigned int v) {
+  p[0] = (v >> 8) & 0xff;
+  p[1] = v & 0xff;
+  return p + 2;
+}
+
+static unsigned char *put24(unsigned char *p, unsigned int v) {
+  p[0] = (v >> 16) & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  p[2] = v & 0xff;
+  return p + 3;
+}
+
+static unsigned char *put32(unsigned char *p, unsigned int v) {
+  p[0] = (v >> 24) & 0xff;
+  p[1] = (v >> 16) & 0xff;
+  p[2] = (v >> 8) & 0xff;
+  p[3] = v & 0xff;
+  return p + 4;
+}
+
+/*
+ * Fills a buffer with printable, loosely compressible text that depends on
+ * a seed.
+ */
+static void fill_text(unsigned char *p, size_t len, unsigned int seed) {
+  static const char alphabet[] =
+      "abcdefghijklmnopqrstuvwxyz0123456789 ABCDEFGHIJKLMNOPQRSTUVWXYZ-_./";
+  unsigned int state = seed * 2654435761u + 1;
+  size_t i;
+
+  for (i = 0; i < len; i++) {
+    state = state * 1103515245u + 12345u;
+    p[i] = alphabet[(state >> 16) % (sizeof(alphabet) - 1)];
+  }
+}
+
+/* Ones' complement sum, for the IP and TCP checksums. */
+static unsigned int cksum_add(unsigned int sum, const unsigned char *p,
+                              size_t len) {
+  size_t i;
+
+  for (i = 0; i + 1 < len; i += 2) {
+    sum += (p[i] << 8) | p[i + 1];
+  }
+  if (len & 1) {
+    sum += p[len - 1] << 8;
+  }
+  return sum;
+}
+
+static unsigned int cksum_fold(unsigned int sum) {
+  while (sum >> 16) {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
+  return ~sum & 0xffff;
+}
+
+static void pcap_write32(bench_pcap_t *pcap, unsigned int v) {
+  fwrite(&v, sizeof(v), 1, pcap->fp);
+}
+
+static void pcap_open(bench_pcap_t *pcap, const char *path) {
+  unsigned short v16;
+
+  memset(pcap, 0, sizeof(*pcap));
+  pcap->fp = fopen(path, "wb");
+  if (pcap->fp == NULL) {
+    perror(path);
+    exit(1);
+  }
+  pcap->secs = 1338854400;
+  pcap->buf = xmalloc(BENCH_SNAPLEN);
+
+  /* Native byte order; readers go by the magic number. */
+  pcap_write32(pcap, 0xa1b2c3d4);
+  v16 = 2;
+  fwrite(&v16, sizeof(v16), 1, pcap->fp);
+  v16 = 4;
+  fwrite(&v16, sizeof(v16), 1, pcap->fp);
+  pcap_write32(pcap, 0);
+  pcap_write32(pcap, 0);
+  pcap_write32(pcap, BENCH_SNAPLEN);
+  pcap_write32(pcap, BENCH_LINKTYPE_ETHERNET);
+  pcap->bytes = 24;
+}
+
+/*
+ * Writes one TCP segment from src to dst, advancing src's sequence number.
+ */
+static void pcap_write_segment(bench_pcap_t *pcap,
+                               bench_endpoint_t *src,
+                               const bench_endpoint_t *dst,
+                               unsigned int tcp_flags,
+                               const unsigned char *data,
+                               size_t len) {
+  unsigned char *p = pcap->buf;
+  unsigned char *ip;
+  unsigned char *tcp;
+  size_t frame_len = ETH_HDR_LEN + IP_HDR_LEN + TCP_HDR_LEN + len;
+  unsigned int sum;
+
+  /* Ethernet */
+  memcpy(p, "\x02\x00\x00\x00\x00\x02\x02\x00\x00\x00\x00\x01", 12);
+  if (src->port == BENCH_SPDY_PORT) {
+    memcpy(p, "\x02\x00\x00\x00\x00\x01\x02\x00\x00\x00\x00\x02", 12);
+  }
+  put16(p + 12, 0x0800);
+
+  /* IPv4 */
+  ip = p + ETH_HDR_LEN;
+  ip[0] = 0x45;
+  ip[1] = 0;
+  put16(ip + 2, IP_HDR_LEN + TCP_HDR_LEN + len);
+  put16(ip + 4, pcap->ip_id++);
+  put16(ip + 6, 0x4000);
+  ip[8] = 64;
+  ip[9] = 6;
+  put16(ip + 10, 0);
+  memcpy(ip + 12, src->addr, 4);
+  memcpy(ip + 16, dst->addr, 4);
+  put16(ip + 10, cksum_fold(cksum_add(0, ip, IP_HDR_LEN)));
+
+  /* TCP */
+  tcp = ip + IP_HDR_LEN;
+  put16(tcp, src->port);
+  put16(tcp + 2, dst->port);
+  put32(tcp + 4, src->seq);
+  put32(tcp + 8, (tcp_flags & TCP_ACK) ? dst->seq : 0);
+  tcp[12] = (TCP_HDR_LEN / 4) << 4;
+  tcp[13] = tcp_flags;
+  put16(tcp + 14, 65535);
+  put16(tcp + 16, 0);
+  put16(tcp + 18, 0);
+  memcpy(tcp + TCP_HDR_LEN, data, len);
+  sum = cksum_add(0, ip + 12, 8);
+  sum += 6 + TCP_HDR_LEN + len;
+  sum = cksum_add(sum, tcp, TCP_HDR_LEN + len);
+  put16(tcp + 16, cksum_fold(sum));
+
+  src->seq += len;
+  if (tcp_flags & (TCP_SYN | TCP_FIN)) {
+    src->seq++;
+  }
+
+  pcap->usecs += 50;
+  if (pcap->usecs >= 1000000) {
+    pcap->secs++;
+    pcap->usecs -= 1000000;
+  }
+  pcap_write32(pcap, pcap->secs);
+  pcap_write32(pcap, pcap->usecs);
+  pcap_write32(pcap, frame_len);
+  pcap_write32(pcap, frame_len);
+  fwrite(p, frame_len, 1, pcap->fp);
+  pcap->frames++;
+  pcap->bytes += 16 + frame_len;
+}
+
+/*
+ * Sends bytes from src to dst in as many segments as the MSS calls for.
+ */
+static void send_bytes(bench_pcap_t *pcap,
+                       const bench_params_t *params,
+                       bench_endpoint_t *src,
+                       const bench_endpoint_t *dst,
+                       const unsigned char *data,
+                       size_t len) {
+  while (len > 0) {
+    size_t seg_len = len < params->mss ? len : params->mss;
+
+    pcap_write_segment(pcap, src, dst,
+                       TCP_ACK | (seg_len == len ? TCP_PSH : 0),
+                       data, seg_len);
+    data += seg_len;
+    len -= seg_len;
+  }
+}
+
+/*
+ * Appends a name/value pair to an uncompressed header block.
+ */
+static unsigned char *put_header(unsigned char *p, const char *name,
+                                 const unsigned char *value,
+                                 size_t value_len) {
+  size_t name_len = strlen(name);
+
+  p = put32(p, name_len);
+  memcpy(p, name, name_len);
+  p = put32(p + name_len, value_len);
+  memcpy(p, value, value_len);
+  return p + value_len;
+}
+
+static unsigned char *put_header_str(unsigned char *p, const char *name,
+                                     const char *value) {
+  return put_header(p, name, (const unsigned char *)value, strlen(value));
+}
+
+/*
+ * Builds a header block from fixed headers followed by the configured
+ * number of extra ones, and compresses it with the sender's deflater.
+ * Returns the compressed length; the block is left in block_buf.
+ */
+static size_t build_header_block(const bench_params_t *params,
+                                 bench_endpoint_t *src,
+                                 const char **fixed,
+                                 unsigned int nfixed,
+                                 unsigned int seed) {
+  static unsigned char *raw;
+  static size_t raw_size;
+  unsigned char *p;
+  size_t raw_len;
+  unsigned int i;
+  char name[32];
+
+  raw_len = 4;
+  for (i = 0; i < nfixed * 2; i++) {
+    raw_len += 4 + strlen(fixed[i]);
+  }
+  raw_len += params->headers * (8 + sizeof(name) + params->header_size);
+  p = reserve(&raw, &raw_size, raw_len);
+
+  p = put32(p, nfixed + params->headers);
+  for (i = 0; i < nfixed; i++) {
+    p = put_header_str(p, fixed[i * 2], fixed[i * 2 + 1]);
+  }
+  for (i = 0; i < params->headers; i++) {
+    unsigned char *value;
+
+    snprintf(name, sizeof(name), "x-bench-%u", i);
+    p = put32(p, strlen(name));
+    memcpy(p, name, strlen(name));
+    p += strlen(name);
+    p = put32(p, params->header_size);
+    value = p;
+    fill_text(value, params->header_size, seed * 131 + i);
+    p += params->header_size;
+  }
+  raw_len = p - raw;
+
+  reserve(&block_buf, &block_buf_size, deflateBound(&src->deflater, raw_len) + 64);
+  src->deflater.next_in = raw;
+  src->deflater.avail_in = raw_len;
+  src->deflater.next_out = block_buf;
+  src->deflater.avail_out = block_buf_size;
+  if (deflate(&src->deflater, Z_SYNC_FLUSH) != Z_OK ||
+      src->deflater.avail_in != 0) {
+    die("header block compression failed");
+  }
+  return block_buf_size - src->deflater.avail_out;
+}
+
+/*
+ * Writes a SPDY/3 control frame header.
+ */
+static unsigned char *put_control_header(unsigned char *p, unsigned int type,
+                                         unsigned int flags,
+                                         size_t length) {
+  p = put16(p, 0x8003);
+  p = put16(p, type);
+  *p++ = flags;
+  return put24(p, length);
+}
+
+static void send_syn_stream(bench_pcap_t *pcap,
+                            const bench_params_t *params,
+                            bench_endpoint_t *client,
+                            const bench_endpoint_t *server,
+                            unsigned int stream_id) {
+  char path[32];
+  const char *fixed[] = {
+    ":method", params->request_size != 0 ? "POST" : "GET",
+    ":path", path,
+    ":version", "HTTP/1.1",
+    ":host", "bench.example.com",
+    ":scheme", "http",
+    "content-type", "text/plain"
+  };
+  size_t block_len;
+  unsigned char *p;
+
+  snprintf(path, sizeof(path), "/bench/%u", stream_id);
+  block_len = build_header_block(params, client, fixed,
+                                 params->request_size != 0 ? 6 : 5,
+                                 stream_id);
+  p = reserve(&frame_buf, &frame_buf_size, 18 + block_len);
+  p = put_control_header(p, SPDY_SYN_STREAM,
+                         params->request_size != 0 ? 0 : SPDY_FLAG_FIN,
+                         10 + block_len);
+  p = put32(p, stream_id);
+  p = put32(p, 0);
+  *p++ = 0;
+  *p++ = 0;
+  memcpy(p, block_buf, block_len);
+  send_bytes(pcap, params, client, server, frame_buf, 18 + block_len);
+}
+
+static void send_syn_reply(bench_pcap_t *pcap,
+                           const bench_params_t *params,
+                           bench_endpoint_t *server,
+                           const bench_endpoint_t *client,
+                           unsigned int stream_id,
+                           size_t body_len) {
+  char content_length[32];
+  const char *fixed[] = {
+    ":status", "200 OK",
+    ":version", "HTTP/1.1",
+    "content-type", "text/plain",
+    "content-length", content_length,
+    "content-encoding", "gzip"
+  };
+  size_t block_len;
+  unsigned char *p;
+
+  snprintf(content_length, sizeof(content_length), "%lu",
+           (unsigned long)body_len);
+  block_len = build_header_block(params, server, fixed,
+                                 params->gzip ? 5 : 4, stream_id + 1);
+  p = reserve(&frame_buf, &frame_buf_size, 12 + block_len);
+  p = put_control_header(p, SPDY_SYN_REPLY, body_len == 0 ? SPDY_FLAG_FIN : 0,
+                         4 + block_len);
+  p = put32(p, stream_id);
+  memcpy(p, block_buf, block_len);
+  send_bytes(pcap, params, server, client, frame_buf, 12 + block_len);
+}
+
+/*
+ * Has dst give back to src the part of a stream's window src has used up.
+ */
+static void send_window_update(bench_pcap_t *pcap,
+                               const bench_params_t *params,
+                               bench_endpoint_t *dst,
+                               const bench_endpoint_t *src,
+                               unsigned int stream_id,
+                               size_t *window) {
+  unsigned char frame[16];
+  unsigned char *p = frame;
+
+  p = put_control_header(p, SPDY_WINDOW_UPDATE, 0, 8);
+  p = put32(p, stream_id & 0x7fffffff);
+  put32(p, SPDY_INITIAL_WINDOW - *window);
+  send_bytes(pcap, params, dst, src, frame, sizeof(frame));
+  *window = SPDY_INITIAL_WINDOW;
+}
+
+/*
+ * Sends a body, or part of one, from src to dst in DATA frames; the last
+ * frame has FIN set if fin is. window is what's left of the stream's
+ * send window, and is kept up to date.
+ */
+static void send_body(bench_pcap_t *pcap,
+                      const bench_params_t *params,
+                      bench_endpoint_t *src,
+                      bench_endpoint_t *dst,
+                      unsigned int stream_id,
+                      const unsigned char *body,
+                      size_t body_len,
+                      int fin,
+                      size_t *window) {
+  while (body_len > 0) {
+    size_t chunk = body_len < params->frame_split ? body_len
+                                                   : params->frame_split;
+    unsigned char *p;
+
+    if (chunk > *window) {
+      send_window_update(pcap, params, dst, src, stream_id, window);
+    }
+    *window -= chunk;
+    p = reserve(&frame_buf, &frame_buf_size, 8 + chunk);
+
+    p = put32(p, stream_id & 0x7fffffff);
+    *p++ = fin && chunk == body_len ? SPDY_FLAG_FIN : 0;
+    p = put24(p, chunk);
+    memcpy(p, body, chunk);
+    send_bytes(pcap, params, src, dst, frame_buf, 8 + chunk);
+    body += chunk;
+    body_len -= chunk;
+  }
+}
+
+static void init_endpoint(bench_endpoint_t *ep, unsigned int addr,
+                          unsigned short port, unsigned int isn) {
+  put32(ep->addr, addr);
+  ep->port = port;
+  ep->seq = isn;
+  memset(&ep->deflater, 0, sizeof(ep->deflater));
+  if (deflateInit(&ep->deflater, Z_DEFAULT_COMPRESSION) != Z_OK ||
+      deflateSetDictionary(&ep->deflater,
+                           (const Bytef *)spdy_dictionary,
+                           spdy_dictionary_len) != Z_OK) {
+    die("deflateInit() failed");
+  }
+}
+
+static void write_connection(bench_pcap_t *pcap,
+                             const bench_params_t *params,
+                             unsigned int index,
+                             const unsigned char *request,
+                             const unsigned char *body,
+                             size_t body_len) {
+  size_t early = params->request_size / 2;
+  bench_endpoint_t client;
+  bench_endpoint_t server;
+  unsigned int i;
+
+  init_endpoint(&client, 0x0a000000 + index + 1,
+                1024 + index % 64000, index * 7919u);
+  init_endpoint(&server, 0x0afffffe, BENCH_SPDY_PORT, index * 104729u);
+
+  pcap_write_segment(pcap, &client, &server, TCP_SYN, NULL, 0);
+  pcap_write_segment(pcap, &server, &client, TCP_SYN | TCP_ACK, NULL, 0);
+  pcap_write_segment(pcap, &client, &server, TCP_ACK, NULL, 0);
+
+  for (i = 0; i < params->streams; i++) {
+    unsigned int stream_id = i * 2 + 1;
+    size_t request_window = SPDY_INITIAL_WINDOW;
+    size_t response_window = SPDY_INITIAL_WINDOW;
+
+    send_syn_stream(pcap, params, &client, &server, stream_id);
+    send_body(pcap, params, &client, &server, stream_id, request, early, 0,
+              &request_window);
+    send_syn_reply(pcap, params, &server, &client, stream_id, body_len);
+    send_body(pcap, params, &client, &server, stream_id, request + early,
+              params->request_size - early, 1, &request_window);
+    send_body(pcap, params, &server, &client, stream_id, body, body_len, 1,
+              &response_window);
+  }
+
+  pcap_write_segment(pcap, &client, &server, TCP_FIN | TCP_ACK, NULL, 0);
+  pcap_write_segment(pcap, &server, &client, TCP_FIN | TCP_ACK, NULL, 0);
+  pcap_write_segment(pcap, &client, &server, TCP_ACK, NULL, 0);
+
+  deflateEnd(&client.deflater);
+  deflateEnd(&server.deflater);
+}
+
+/*
+ * Makes the entity body every stream carries, gzipped if asked to.
+ */
+static unsigned char *make_body(const bench_params_t *params,
+                                size_t *body_len) {
+  unsigned char *text = xmalloc(params->body_size);
+  unsigned char *gz;
+  z_stream zs;
+
+  fill_text(text, params->body_size, 1);
+  if (!params->gzip) {
+    *body_len = params->body_size;
+    return text;
+  }
+
+  memset(&zs, 0, sizeof(zs));
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16,
+                   8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    die("deflateInit2() failed");
+  }
+  gz = xmalloc(deflateBound(&zs, params->body_size) + 32);
+  zs.next_in = text;
+  zs.avail_in = params->body_size;
+  zs.next_out = gz;
+  zs.avail_out = deflateBound(&zs, params->body_size) + 32;
+  if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+    die("body compression failed");
+  }
+  *body_len = zs.total_out;
+  deflateEnd(&zs);
+  free(text);
+  return gz;
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "Usage: spdy-bench-gen -o <file> [options]\n"
+          "  -c <n>  connections (default 100)\n"
+          "  -s <n>  streams per connection (default 10)\n"
+          "  -n <n>  extra headers per header block (default 8)\n"
+          "  -l <n>  length of each extra header value (default 32)\n"
+          "  -b <n>  body size in bytes, before gzip (default 4096)\n"
+          "  -f <n>  largest DATA frame payload, up to the 64KB stream\n"
+          "          window (default 4096)\n"
+          "  -m <n>  TCP MSS (default 1460)\n"
+          "  -z      gzip bodies, with Content-Encoding: gzip\n"
+          "  -p <n>  POST an n-byte body on each stream, replying before\n"
+          "          its last DATA frame (default 0, for GETs)\n");
+  exit(1);
+}
+
+static unsigned parse_count(const char *arg, unsigned min, unsigned max) {
+  char *end;
+  unsigned long v = strtoul(arg, &end, 10);
+
+  if (*arg == '\0' || *end != '\0' || v < min || v > max) {
+    usage();
+  }
+  return (unsigned)v;
+}
+
+int main(int argc, char **argv) {
+  bench_params_t params;
+  bench_pcap_t pcap;
+  unsigned char *request;
+  unsigned char *body;
+  size_t body_len;
+  unsigned int i;
+  int opt;
+
+  memset(&params, 0, sizeof(params));
+  params.connections = 100;
+  params.streams = 10;
+  params.headers = 8;
+  params.header_size = 32;
+  params.body_size = 4096;
+  params.frame_split = 4096;
+  params.mss = 1460;
+
+  while ((opt = getopt(argc, argv, "o:c:s:n:l:b:f:m:zp:")) != -1) {
+    switch (opt) {
+      case 'o':
+        params.path = optarg;
+        break;
+      case 'c':
+        params.connections = parse_count(optarg, 1, 0xfffffd);
+        break;
+      case 's':
+        params.streams = parse_count(optarg, 1, 0x3fffffff);
+        break;
+      case 'n':
+        params.headers = parse_count(optarg, 0, 1000);
+        break;
+      case 'l':
+        params.header_size = parse_count(optarg, 0, 16384);
+        break;
+      case 'b':
+        params.body_size = parse_count(optarg, 0, 1 << 30);
+        break;
+      case 'f':
+        params.frame_split = parse_count(optarg, 1, SPDY_INITIAL_WINDOW);
+        break;
+      case 'm':
+        params.mss = parse_count(optarg, 1,
+                                 BENCH_SNAPLEN - ETH_HDR_LEN - IP_HDR_LEN -
+                                 TCP_HDR_LEN);
+        break;
+      case 'z':
+        params.gzip = 1;
+        break;
+      case 'p':
+        params.request_size = parse_count(optarg, 0, 1 << 30);
+        break;
+      default:
+        usage();
+    }
+  }
+  if (params.path == NULL || optind != argc) {
+    usage();
+  }
+
+  request = xmalloc(params.request_size);
+  fill_text(request, params.request_size, 2);
+  body = make_body(&params, &body_len);
+  pcap_open(&pcap, params.path);
+  for (i = 0; i < params.connections; i++) {
+    write_connection(&pcap, &params, i, request, body, body_len);
+  }
+  if (fclose(pcap.fp) != 0) {
+    perror(params.path);
+    return 1;
+  }
+  printf("%s: %lu frames, %llu bytes\n", params.path, pcap.frames, pcap.bytes);
+
+  free(request);
+  free(body);
+  free(pcap.buf);
+  return 0;
+}
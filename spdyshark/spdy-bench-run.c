@@ -0,0 +1,218 @@
+/* spdy-bench-run.c
+ * Times tshark over captures and reports throughput and peak memory
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+/*
+ * Each capture is read twice, once in a single pass and once with -2, by
+ * a tshark of its own, so peak RSS is that process's alone. Output is
+ * thrown away; only the wall clock time and the child's resource usage
+ * count. Arguments after "--" are passed on to tshark.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define BENCH_MAX_TSHARK_ARGS 64
+
+/*
+ * Counts the records in a libpcap file, by following their headers.
+ * Returns -1 if it isn't one.
+ */
+static long count_frames(const char *path) {
+  FILE *fp = fopen(path, "rb");
+  unsigned char hdr[24];
+  unsigned char rec[16];
+  int swapped;
+  long frames = 0;
+
+  if (fp == NULL) {
+    return -1;
+  }
+  if (fread(hdr, sizeof(hdr), 1, fp) != 1) {
+    fclose(fp);
+    return -1;
+  }
+  if (memcmp(hdr, "\xd4\xc3\xb2\xa1", 4) == 0 ||
+      memcmp(hdr, "\x4d\x3c\xb2\xa1", 4) == 0) {
+    swapped = 0;
+  } else if (memcmp(hdr, "\xa1\xb2\xc3\xd4", 4) == 0 ||
+             memcmp(hdr, "\xa1\xb2\x3c\x4d", 4) == 0) {
+    swapped = 1;
+  } else {
+    fclose(fp);
+    return -1;
+  }
+  while (fread(rec, sizeof(rec), 1, fp) == 1) {
+    /* Little-endian unless the magic said otherwise. */
+    unsigned long caplen = swapped ?
+        ((unsigned long)rec[8] << 24) | (rec[9] << 16) | (rec[10] << 8) |
+        rec[11] :
+        ((unsigned long)rec[11] << 24) | (rec[10] << 16) | (rec[9] << 8) |
+        rec[8];
+
+    if (fseek(fp, caplen, SEEK_CUR) != 0) {
+      break;
+    }
+    frames++;
+  }
+  fclose(fp);
+  return frames;
+}
+
+/*
+ * Runs tshark over a capture, returning its exit status, and its wall
+ * clock time and peak RSS in kilobytes through the pointers.
+ */
+static int run_tshark(char **argv, double *seconds, long *peak_kb) {
+  struct timeval start;
+  struct timeval end;
+  struct rusage usage;
+  int status;
+  pid_t pid;
+
+  gettimeofday(&start, NULL);
+  pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    exit(1);
+  }
+  if (pid == 0) {
+    int null_fd = open("/dev/null", O_WRONLY);
+
+    if (null_fd >= 0) {
+      dup2(null_fd, STDOUT_FILENO);
+      close(null_fd);
+    }
+    execvp(argv[0], argv);
+    perror(argv[0]);
+    _exit(127);
+  }
+  if (wait4(pid, &status, 0, &usage) < 0) {
+    perror("wait4");
+    exit(1);
+  }
+  gettimeofday(&end, NULL);
+
+  *seconds = (end.tv_sec - start.tv_sec) +
+      (end.tv_usec - start.tv_usec) / 1e6;
+#ifdef __APPLE__
+  /* Darwin reports bytes rather than kilobytes. */
+  *peak_kb = usage.ru_maxrss / 1024;
+#else
+  *peak_kb = usage.ru_maxrss;
+#endif
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "Usage: spdy-bench-run [-t <tshark>] <capture>... "
+          "[-- <tshark options>]\n");
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  const char *tshark = "tshark";
+  char *tshark_argv[BENCH_MAX_TSHARK_ARGS + 8];
+  int nextra = 0;
+  int first_capture;
+  int ncaptures;
+  int failed = 0;
+  int i;
+
+  if (argc > 2 && strcmp(argv[1], "-t") == 0) {
+    tshark = argv[2];
+    first_capture = 3;
+  } else {
+    first_capture = 1;
+  }
+  for (ncaptures = 0; first_capture + ncaptures < argc; ncaptures++) {
+    if (strcmp(argv[first_capture + ncaptures], "--") == 0) {
+      nextra = argc - (first_capture + ncaptures + 1);
+      break;
+    }
+  }
+  if (ncaptures == 0 || nextra > BENCH_MAX_TSHARK_ARGS) {
+    usage();
+  }
+
+  printf("%-36s %4s %9s %9s %11s %9s %12s\n",
+         "capture", "pass", "frames", "seconds", "frames/s", "MB/s",
+         "peak RSS KB");
+  for (i = first_capture; i < first_capture + ncaptures; i++) {
+    const char *path = argv[i];
+    struct stat st;
+    long frames = count_frames(path);
+    int two_pass;
+
+    if (frames < 0 || stat(path, &st) != 0) {
+      fprintf(stderr, "spdy-bench-run: %s: not a libpcap file\n", path);
+      failed = 1;
+      continue;
+    }
+    for (two_pass = 0; two_pass <= 1; two_pass++) {
+      double seconds;
+      long peak_kb;
+      int n = 0;
+      int j;
+      int status;
+
+      tshark_argv[n++] = (char *)tshark;
+      tshark_argv[n++] = "-n";
+      tshark_argv[n++] = "-q";
+      if (two_pass) {
+        tshark_argv[n++] = "-2";
+      }
+      tshark_argv[n++] = "-r";
+      tshark_argv[n++] = (char *)path;
+      for (j = 0; j < nextra; j++) {
+        tshark_argv[n++] = argv[argc - nextra + j];
+      }
+      tshark_argv[n] = NULL;
+
+      status = run_tshark(tshark_argv, &seconds, &peak_kb);
+      if (status != 0) {
+        fprintf(stderr, "spdy-bench-run: %s exited with status %d on %s\n",
+                tshark, status, path);
+        failed = 1;
+        break;
+      }
+      if (seconds <= 0) {
+        seconds = 1e-6;
+      }
+      printf("%-36s %4d %9ld %9.3f %11.0f %9.2f %12ld\n",
+             path, two_pass ? 2 : 1, frames, seconds, frames / seconds,
+             st.st_size / seconds / (1024 * 1024), peak_kb);
+      fflush(stdout);
+    }
+  }
+  return failed;
+}
@@ -0,0 +1,257 @@
+/* spdy-parse.c
+ * SPDY framing, header block parsing and inflation, free of epan
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+#include <zlib.h>
+
+#include "spdy-parse.h"
+
+#define SPDY_GET_NTOHS(p) \
+  ((guint16)(((guint16)(p)[0] << 8) | (guint16)(p)[1]))
+#define SPDY_GET_NTOH24(p) \
+  (((guint32)(p)[0] << 16) | ((guint32)(p)[1] << 8) | (guint32)(p)[2])
+#define SPDY_GET_NTOHL(p) \
+  (((guint32)(p)[0] << 24) | ((guint32)(p)[1] << 16) | \
+   ((guint32)(p)[2] << 8) | (guint32)(p)[3])
+
+/* Stream IDs are 31 bits, after a reserved or control bit. */
+#define SPDY_GET_STREAM_ID(p) (SPDY_GET_NTOHL(p) & 0x7fffffff)
+
+/*
+ * Decodes the frame header at data, which must hold at least
+ * SPDY_FRAME_HEADER_LEN bytes.
+ */
+void spdy_parse_frame_header(const guint8 *data, spdy_frame_header_t *hdr) {
+  hdr->control = (data[0] & 0x80) != 0;
+  if (hdr->control) {
+    hdr->version = SPDY_GET_NTOHS(data) & 0x7fff;
+    hdr->type = SPDY_GET_NTOHS(data + 2);
+    hdr->stream_id = 0;
+  } else {
+    hdr->version = 0; /* Version doesn't apply to DATA. */
+    hdr->type = SPDY_DATA;
+    hdr->stream_id = SPDY_GET_STREAM_ID(data);
+  }
+  hdr->flags = data[4];
+  hdr->length = SPDY_GET_NTOH24(data + 5);
+}
+
+/*
+ * Decodes the fields of a header-bearing frame's payload that come ahead
+ * of its header block. Returns FALSE if the payload is too short for
+ * them, or the frame type doesn't carry a header block.
+ */
+gboolean spdy_parse_header_frame(guint16 type, const guint8 *payload,
+                                 guint32 length, spdy_header_frame_t *frame) {
+  switch (type) {
+    case SPDY_SYN_STREAM:
+      frame->header_block_offset = 10;
+      break;
+    case SPDY_SYN_REPLY:
+    case SPDY_HEADERS:
+      frame->header_block_offset = 4;
+      break;
+    default:
+      return FALSE;
+  }
+  if (length < frame->header_block_offset) {
+    return FALSE;
+  }
+  frame->stream_id = SPDY_GET_STREAM_ID(payload);
+  if (type == SPDY_SYN_STREAM) {
+    frame->associated_stream_id = SPDY_GET_STREAM_ID(payload + 4);
+    frame->priority = payload[8] >> 5;
+  } else {
+    frame->associated_stream_id = 0;
+    frame->priority = 0;
+  }
+  frame->header_block_length = length - frame->header_block_offset;
+  return TRUE;
+}
+
+/*
+ * Starts walking an inflated header block. Returns FALSE if it's too
+ * short to hold even the number of pairs.
+ */
+gboolean spdy_header_iter_init(spdy_header_iter_t *iter, const guint8 *block,
+                               guint32 length) {
+  memset(iter, 0, sizeof(*iter));
+  iter->block = block;
+  iter->length = length;
+  if (length < 4) {
+    return FALSE;
+  }
+  iter->num_headers = SPDY_GET_NTOHL(block);
+  iter->remaining = iter->num_headers;
+  iter->pos = 4;
+  return TRUE;
+}
+
+/*
+ * Reads the next name/value pair. Anything but SPDY_HEADER_PAIR ends the
+ * walk; the other values say where a truncated block ran out.
+ */
+spdy_header_status_t spdy_header_iter_next(spdy_header_iter_t *iter) {
+  guint32 left;
+
+  if (iter->remaining == 0) {
+    return SPDY_HEADER_END;
+  }
+  iter->remaining--;
+
+  left = iter->length - iter->pos;
+  if (left < 4) {
+    return SPDY_HEADER_SHORT_NAME_LENGTH;
+  }
+  iter->name_offset = iter->pos;
+  iter->name_length = SPDY_GET_NTOHL(iter->block + iter->pos);
+  iter->pos += 4;
+  left -= 4;
+  if (iter->name_length > left) {
+    return SPDY_HEADER_SHORT_NAME;
+  }
+  iter->name = iter->block + iter->pos;
+  iter->pos += iter->name_length;
+  left -= iter->name_length;
+
+  if (left < 4) {
+    return SPDY_HEADER_SHORT_VALUE_LENGTH;
+  }
+  iter->value_offset = iter->pos;
+  iter->value_length = SPDY_GET_NTOHL(iter->block + iter->pos);
+  iter->pos += 4;
+  left -= 4;
+  if (iter->value_length > left) {
+    return SPDY_HEADER_SHORT_VALUE;
+  }
+  iter->value = iter->block + iter->pos;
+  iter->pos += iter->value_length;
+  return SPDY_HEADER_PAIR;
+}
+
+/*
+ * Sets up an inflater for one direction's header blocks. Returns NULL if
+ * zlib can't.
+ */
+z_streamp spdy_new_header_inflater(void) {
+  z_streamp decomp = g_malloc0(sizeof(z_stream));
+
+  if (inflateInit(decomp) != Z_OK) {
+    g_free(decomp);
+    return NULL;
+  }
+  return decomp;
+}
+
+void spdy_free_header_inflater(z_streamp decomp) {
+  if (decomp != NULL) {
+    inflateEnd(decomp);
+    g_free(decomp);
+  }
+}
+
+static int spdy_plain_inflate(z_streamp decomp, int flush,
+                              gpointer user_data _U_) {
+  return inflate(decomp, flush);
+}
+
+/*
+ * Inflates a header block into buf, which is grown as needed up to
+ * SPDY_INFLATE_BUF_MAX_SIZE, and sets *uncomp_length to the number of
+ * bytes inflated. Header blocks of a direction must be inflated in order,
+ * with the same inflater. inflate_func, if not NULL, is called in place of
+ * inflate(). Returns FALSE if the block can't be inflated.
+ */
+gboolean spdy_inflate_header_block(z_streamp decomp,
+                                   const guint8 *block,
+                                   guint32 length,
+                                   spdy_inflate_buf_t *buf,
+                                   guint *uncomp_length,
+                                   spdy_inflate_func_t inflate_func,
+                                   gpointer user_data) {
+  int retcode;
+  guint used = 0;
+
+  if (inflate_func == NULL) {
+    inflate_func = spdy_plain_inflate;
+  }
+  if (buf->data == NULL) {
+    buf->size = SPDY_INFLATE_BUF_INITIAL_SIZE;
+    buf->data = g_malloc(buf->size);
+  }
+  decomp->next_in = (Bytef *)block;
+  decomp->avail_in = length;
+
+  for (;;) {
+    if (used == buf->size) {
+      /* Out of room; grow the scratch buffer geometrically. */
+      if (buf->size >= SPDY_INFLATE_BUF_MAX_SIZE) {
+        return FALSE;
+      }
+      buf->size *= 2;
+      buf->data = g_realloc(buf->data, buf->size);
+    }
+    decomp->next_out = buf->data + used;
+    decomp->avail_out = buf->size - used;
+    retcode = inflate_func(decomp, Z_SYNC_FLUSH, user_data);
+    if (retcode == Z_NEED_DICT) {
+      /* This fails if the block was compressed with another dictionary. */
+      retcode = inflateSetDictionary(decomp, (const Bytef *)spdy_dictionary,
+                                     spdy_dictionary_len);
+      if (retcode == Z_OK) {
+        retcode = inflate_func(decomp, Z_SYNC_FLUSH, user_data);
+      }
+    }
+    used = buf->size - decomp->avail_out;
+
+    /*
+     * A full output buffer may just mean that inflate() has more to give;
+     * if a further call finds nothing left, it reports Z_BUF_ERROR.
+     */
+    if (retcode == Z_BUF_ERROR && decomp->avail_in == 0 && used != 0) {
+      break;
+    }
+    if (retcode != Z_OK) {
+      return FALSE;
+    }
+    if (decomp->avail_in == 0 && decomp->avail_out != 0) {
+      break;
+    }
+  }
+
+  *uncomp_length = used;
+  return TRUE;
+}
+
+void spdy_free_inflate_buf(spdy_inflate_buf_t *buf) {
+  g_free(buf->data);
+  buf->data = NULL;
+  buf->size = 0;
+}
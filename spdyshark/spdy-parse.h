@@ -0,0 +1,159 @@
+/* spdy-parse.h
+ * SPDY framing, header block parsing and inflation, free of epan
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+/*
+ * These routines work on plain byte buffers and keep no state of their
+ * own, so that the dissector and the offline analyzer (spdy-analyze.c)
+ * can share them, the latter from several threads at once.
+ */
+
+#ifndef __SPDY_PARSE_H__
+#define __SPDY_PARSE_H__
+#pragma once
+
+#include <glib.h>
+#include <zlib.h>
+
+#include "spdy-dictionary.h"
+
+/* config.h has this; spdy-analyze.c may be built without it. */
+#ifndef _U_
+# if defined(__GNUC__)
+#  define _U_ __attribute__((unused))
+# else
+#  define _U_
+# endif
+#endif
+
+/* The types of SPDY frames */
+#define SPDY_DATA           0
+#define SPDY_SYN_STREAM     1
+#define SPDY_SYN_REPLY      2
+#define SPDY_RST_STREAM     3
+#define SPDY_SETTINGS       4
+#define SPDY_PING           6
+#define SPDY_GOAWAY         7
+#define SPDY_HEADERS        8
+#define SPDY_WINDOW_UPDATE  9
+#define SPDY_CREDENTIAL    10
+#define SPDY_INVALID       11
+
+#define SPDY_FLAG_FIN  0x01
+#define SPDY_FLAG_UNIDIRECTIONAL 0x02
+
+#define SPDY_FRAME_HEADER_LEN 8
+
+/* Scratch space for inflating header blocks, capped to bound header bombs. */
+#define SPDY_INFLATE_BUF_INITIAL_SIZE 16384
+#define SPDY_INFLATE_BUF_MAX_SIZE (16 * 1024 * 1024)
+
+/*
+ * The common frame header. Control frames have a version and type; DATA
+ * frames, which have type SPDY_DATA, have a stream ID instead.
+ */
+typedef struct _spdy_frame_header_t {
+    gboolean control;
+    guint16  version;
+    guint16  type;
+    guint32  stream_id;
+    guint8   flags;
+    guint32  length;      /* of the payload */
+} spdy_frame_header_t;
+
+/*
+ * The fields of a SYN_STREAM, SYN_REPLY or HEADERS payload ahead of its
+ * header block. associated_stream_id and priority are SYN_STREAM's only.
+ */
+typedef struct _spdy_header_frame_t {
+    guint32  stream_id;
+    guint32  associated_stream_id;
+    guint8   priority;
+    guint32  header_block_offset;    /* from the start of the payload */
+    guint32  header_block_length;
+} spdy_header_frame_t;
+
+/*
+ * Walks the name/value pairs of an inflated header block. Offsets are
+ * from the start of the block, and are those of each string's length.
+ */
+typedef struct _spdy_header_iter_t {
+    const guint8 *block;
+    guint32  length;
+    guint32  pos;
+    guint32  num_headers;     /* in all, from the block */
+    guint32  remaining;       /* still to be read */
+    /* The pair last read */
+    guint32  name_offset;
+    guint32  name_length;
+    const guint8 *name;
+    guint32  value_offset;
+    guint32  value_length;
+    const guint8 *value;
+} spdy_header_iter_t;
+
+/* What spdy_header_iter_next() found. */
+typedef enum _spdy_header_status_t {
+    SPDY_HEADER_PAIR,
+    SPDY_HEADER_END,
+    SPDY_HEADER_SHORT_NAME_LENGTH,
+    SPDY_HEADER_SHORT_NAME,
+    SPDY_HEADER_SHORT_VALUE_LENGTH,
+    SPDY_HEADER_SHORT_VALUE
+} spdy_header_status_t;
+
+/* A growable buffer that header blocks are inflated into. */
+typedef struct _spdy_inflate_buf_t {
+    guint8  *data;
+    guint    size;
+} spdy_inflate_buf_t;
+
+/*
+ * Something to call in place of inflate(), such as one that counts or
+ * times the calls.
+ */
+typedef int (*spdy_inflate_func_t)(z_streamp decomp, int flush,
+                                   gpointer user_data);
+
+void spdy_parse_frame_header(const guint8 *data, spdy_frame_header_t *hdr);
+
+gboolean spdy_parse_header_frame(guint16 type, const guint8 *payload,
+                                 guint32 length, spdy_header_frame_t *frame);
+
+gboolean spdy_header_iter_init(spdy_header_iter_t *iter, const guint8 *block,
+                               guint32 length);
+spdy_header_status_t spdy_header_iter_next(spdy_header_iter_t *iter);
+
+z_streamp spdy_new_header_inflater(void);
+void spdy_free_header_inflater(z_streamp decomp);
+
+gboolean spdy_inflate_header_block(z_streamp decomp,
+                                   const guint8 *block,
+                                   guint32 length,
+                                   spdy_inflate_buf_t *buf,
+                                   guint *uncomp_length,
+                                   spdy_inflate_func_t inflate_func,
+                                   gpointer user_data);
+void spdy_free_inflate_buf(spdy_inflate_buf_t *buf);
+
+#endif /* __SPDY_PARSE_H__ */